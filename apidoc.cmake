@@ -0,0 +1,6 @@
+# Extract /// from Maud's sources in build steps rather than inside sphinx
+set(
+  MAUD_APIDOC_PATTERNS
+  "^[^/]*[.]cxx$"
+  "^cmake_modules/[^/]*[.][ch]xx$"
+)
@@ -0,0 +1,516 @@
+// Boost Licensed
+//
+module;
+#include <iomanip>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+export module maud_:apidoc;
+import :parsing;
+
+// The content of an individual ///, as in trike.Comment
+export struct Comment {
+  std::string file;
+  int next_line = 0;
+  std::vector<std::string> text;
+  std::string clang_cursor_kind;
+};
+
+export struct DirectiveComment {
+  std::string directive, argument, namespace_name;
+  Comment comment;
+};
+
+// All /// content in a file, as in trike.FileContent
+export struct FileContent {
+  std::string module;
+  std::vector<Comment> floating_comments;
+  std::vector<DirectiveComment> directive_comments;
+  double mtime_when_parsed = 0;
+};
+
+// Extract /// from a source file without libclang. Most /// sit right above simple
+// declarations which can be classified from their leading tokens; if anything in the
+// file is not that simple, nullopt is returned and libclang should be used instead.
+export std::optional<FileContent> extract_apidoc(std::string file, char const *source);
+
+export void write_json(std::ostream &os, FileContent const &file_content);
+
+struct Token {
+  char const *begin, *end;
+  std::string_view view() const { return {begin, end}; }
+  bool operator==(std::string_view s) const { return view() == s; }
+};
+
+bool is_identifier_char(char c) {
+  return (c >= 'a' and c <= 'z') or (c >= 'A' and c <= 'Z') or (c >= '0' and c <= '9')
+      or c == '_';
+}
+
+bool is_string_prefix(std::string_view identifier) {
+  for (std::string_view prefix : {"u8", "u", "U", "L", "R", "u8R", "uR", "UR", "LR"}) {
+    if (identifier == prefix) return true;
+  }
+  return false;
+}
+
+struct Scope {
+  enum { NAMESPACE, STRUCT, TRANSPARENT, OPAQUE } kind;
+  // The name trike would use when this scope is the parent of a documented decl
+  std::string spelling;
+  std::string name;
+};
+
+// Things which libclang might attach to a declaration differently than we would.
+std::set<std::string_view> const UNCLASSIFIABLE{
+    "static",  "inline",   "constexpr",    "consteval", "constinit", "extern",
+    "virtual", "explicit", "friend",       "mutable",   "operator",  "typedef",
+    "union",   "enum",     "thread_local", "namespace", "alignas",   "__attribute__",
+    "public",  "private",  "protected",    "asm",       "concept",   "decltype",
+};
+
+// trike drops these from declaration strings
+std::set<std::string_view> const OMITTED{
+    "class", "struct", "export", "union", "using", "typedef",
+};
+
+struct Declaration {
+  std::string directive, argument, kind, namespace_name;
+  char const *last_token_end;
+  bool opens_struct = false;
+};
+
+class Extractor {
+ public:
+  Extractor(std::string file, char const *source)
+      : _s{source}, _line_position{source}, _file{std::move(file)} {}
+
+  std::optional<FileContent> extract() {
+    while (true) {
+      chomp_past_whitespace(_s);
+      if (*_s == 0) break;
+
+      if (_s[0] == '/' and _s[1] == '/') {
+        if (_s[2] == '/' and line(_s) >= _skip_until_line) {
+          if (not read_comment()) return std::nullopt;
+          continue;
+        }
+        chomp_until(first_of<'\n'>, _s);
+        continue;
+      }
+
+      if (_s[0] == '/' and _s[1] == '*') {
+        _s += 2;
+        while (true) {
+          chomp_until(first_of<'*'>, _s);
+          if (*_s == 0) return std::nullopt;
+          if (_s[1] == '/') break;
+          ++_s;
+        }
+        _s += 2;
+        continue;
+      }
+
+      if (_s[0] == '#') {
+        chomp_past_unescaped_line_ending(_s);
+        continue;
+      }
+
+      if (_s[0] == '\'') {
+        // Skip character literals (but not digit separators, which follow
+        // an identifier character and are chomped with it below).
+        ++_s;
+        while (*_s != 0 and *_s != '\'' and *_s != '\n') {
+          _s += *_s == '\\' and _s[1] != 0 ? 2 : 1;
+        }
+        if (*_s != '\'') return std::nullopt;
+        ++_s;
+        continue;
+      }
+
+      auto token = next_token();
+      if (token == "{") {
+        open_scope();
+        _statement.clear();
+      } else if (token == "}") {
+        if (_scopes.empty()) return std::nullopt;
+        _scopes.pop_back();
+        _statement.clear();
+      } else if (token == ";") {
+        _statement.clear();
+      } else if (token == ":" and _statement.size() == 1
+                 and (_statement[0] == "public" or _statement[0] == "protected"
+                      or _statement[0] == "private")) {
+        _statement.clear();
+      } else {
+        _statement.push_back(token);
+      }
+    }
+
+    if (not _scopes.empty()) return std::nullopt;
+    return std::move(_file_content);
+  }
+
+ private:
+  // 1-based line number of a position, counted from the last position queried
+  int line(char const *position) {
+    for (; _line_position < position; ++_line_position) {
+      if (*_line_position == '\n') ++_line;
+    }
+    for (; _line_position > position; --_line_position) {
+      if (_line_position[-1] == '\n') --_line;
+    }
+    return _line;
+  }
+
+  std::string_view rest_of_line(char const *s) {
+    auto end = first_of<'\n'>(s);
+    if (end != s and end[-1] == '\r') --end;
+    return {s, end};
+  }
+
+  Token next_token() {
+    auto begin = _s;
+    if (is_identifier_char(*_s)) {
+      while (is_identifier_char(*_s) or (*_s == '\'' and is_identifier_char(_s[1]))) ++_s;
+      // An encoding prefix is part of its string literal's token, as in libclang.
+      // (chomp_until_end_of_string_literal reads R"delim(...)delim" as raw.)
+      if (*_s == '"' and is_string_prefix({begin, _s})) {
+        chomp_until_end_of_string_literal(_s);
+      }
+    } else if (*_s == '"') {
+      chomp_until_end_of_string_literal(_s);
+    } else {
+      ++_s;
+    }
+    return {begin, _s};
+  }
+
+  // Read a block of /// (as trike.Comment.read_from_tokens does) and whatever it
+  // documents. Returns false if it couldn't be classified confidently.
+  bool read_comment() {
+    Comment comment{.file = _file};
+    while (true) {
+      int comment_line = line(_s);
+      if (not comment.text.empty() and comment_line > comment.next_line) break;
+      if (_s[0] == '/' and _s[1] == '*') {
+        // trike doesn't support these interspersed with ///
+        return false;
+      }
+      if (_s[0] != '/' or _s[1] != '/') break;
+
+      auto text = rest_of_line(_s);
+      if (text.starts_with("///")) comment.text.emplace_back(text);
+      comment.next_line = comment_line + 1;
+      chomp_until(first_of<'\n'>, _s);
+      chomp_past_whitespace(_s);
+    }
+
+    bool floating = *_s == 0 or line(_s) > comment.next_line;
+
+    std::optional<Declaration> declaration;
+    if (not floating) {
+      declaration = classify();
+      if (not declaration) return false;
+      _skip_until_line = line(declaration->last_token_end) + 1;
+      if (declaration->opens_struct) _documented_struct = declaration->argument;
+    }
+
+    if (comment.text[0].starts_with("///.. ")) {
+      if (floating) {
+        // trike's namespaces become misaligned with its directives in this case
+        return false;
+      }
+      auto explicit_directive = std::string_view{comment.text[0]}.substr(6);
+      auto sep = explicit_directive.find("::");
+      if (sep == std::string_view::npos) return false;
+      declaration->directive = strip(explicit_directive.substr(0, sep));
+      declaration->argument = strip(explicit_directive.substr(sep + 2));
+      comment.text.erase(comment.text.begin());
+    }
+
+    if (floating) {
+      _file_content.floating_comments.push_back(std::move(comment));
+      return true;
+    }
+
+    comment.clang_cursor_kind = std::move(declaration->kind);
+    _file_content.directive_comments.push_back({
+        .directive = std::move(declaration->directive),
+        .argument = std::move(declaration->argument),
+        .namespace_name = std::move(declaration->namespace_name),
+        .comment = std::move(comment),
+    });
+    return true;
+  }
+
+  static std::string strip(std::string_view s) {
+    auto begin = s.find_first_not_of(" \t");
+    if (begin == std::string_view::npos) return "";
+    return std::string{s.substr(begin, s.find_last_not_of(" \t") - begin + 1)};
+  }
+
+  // Join tokens as trike.join_tokens does: with a single space
+  // wherever there was anything between them in the source.
+  static std::string join(std::vector<Token> const &tokens) {
+    std::string joined;
+    char const *previous_end = nullptr;
+    for (auto token : tokens) {
+      if (previous_end != nullptr and previous_end != token.begin) joined += ' ';
+      joined += token.view();
+      previous_end = token.end;
+    }
+    return joined;
+  }
+
+  std::optional<std::string> namespace_name() const {
+    std::string name;
+    for (auto const &scope : _scopes) {
+      if (scope.kind == Scope::TRANSPARENT) continue;
+      if (scope.kind == Scope::OPAQUE) return std::nullopt;
+      if (not name.empty()) name += "::";
+      name += scope.spelling;
+    }
+    return name;
+  }
+
+  std::optional<Declaration> classify() {
+    auto s = _s;
+    if (*s == '#') {
+      ++s;
+      chomp_until(first_not_of<' ', '\t'>, s);
+      if (not try_chomp_prefix("define", s)) return std::nullopt;
+      chomp_until(first_not_of<' ', '\t'>, s);
+
+      std::vector<Token> tokens;
+      auto begin = s;
+      while (is_identifier_char(*s)) ++s;
+      if (s == begin) return std::nullopt;
+      tokens.push_back({begin, s});
+      if (*s == '(') {
+        // function macro; include parameters
+        while (tokens.back() != ")") {
+          chomp_until(first_not_of<' ', '\t'>, s);
+          if (*s == 0 or *s == '\n' or *s == '\\') return std::nullopt;
+          begin = s;
+          while (is_identifier_char(*s)) ++s;
+          if (s == begin) ++s;
+          tokens.push_back({begin, s});
+        }
+      }
+      return Declaration{
+          .directive = "c:macro",
+          .argument = join(tokens),
+          .kind = "MACRO_DEFINITION",
+          .last_token_end = s,
+      };
+    }
+
+    auto namespace_name = this->namespace_name();
+    if (not namespace_name) return std::nullopt;
+
+    // Read the declaration up to its body or terminating semicolon, as trike does.
+    std::vector<Token> tokens;
+    std::optional<Token> terminator;
+    auto saved = _s;
+    while (true) {
+      chomp_past_whitespace(_s);
+      if (*_s == 0 or *_s == '#' or *_s == '\'') break;
+      if (_s[0] == '/' and (_s[1] == '/' or _s[1] == '*')) break;
+      if (_s[0] == '[' and _s[1] == '[') break;
+      auto token = next_token();
+      if (token == "{" or token == ";") {
+        terminator = token;
+        break;
+      }
+      if (token == "}" or token == "~" or UNCLASSIFIABLE.contains(token.view())) break;
+      tokens.push_back(token);
+    }
+    _s = saved;
+    if (tokens.empty() or not terminator) return std::nullopt;
+
+    Declaration declaration{
+        .namespace_name = std::move(*namespace_name),
+        .last_token_end = tokens.back().end,
+        .opens_struct = *terminator == "{",
+    };
+
+    size_t i = tokens[0] == "export" ? 1 : 0;
+    bool is_template = false;
+    if (i < tokens.size() and tokens[i] == "template") {
+      if (++i == tokens.size() or tokens[i] != "<") return std::nullopt;
+      for (int depth = 0; i < tokens.size(); ++i) {
+        if (tokens[i] == "<") ++depth;
+        if (tokens[i] == ">" and --depth == 0) break;
+        if (tokens[i] == "(") return std::nullopt;
+      }
+      ++i;
+      is_template = true;
+    }
+    if (i >= tokens.size()) return std::nullopt;
+
+    auto is_name = [&](size_t i) {
+      return i < tokens.size() and is_identifier_char(*tokens[i].begin)
+         and not(*tokens[i].begin >= '0' and *tokens[i].begin <= '9');
+    };
+
+    bool in_struct = not _scopes.empty() and _scopes.back().kind == Scope::STRUCT;
+
+    if (tokens[i] == "struct" or tokens[i] == "class") {
+      if (not is_name(i + 1)) return std::nullopt;
+      if (i + 2 < tokens.size() and tokens[i + 2] == "<") {
+        // specializations are kinds of their own
+        return std::nullopt;
+      }
+      declaration.directive = "cpp:struct";
+      declaration.kind = is_template           ? "CLASS_TEMPLATE"
+                       : tokens[i] == "struct" ? "STRUCT_DECL"
+                                               : "CLASS_DECL";
+    } else if (tokens[i] == "using") {
+      if (not is_name(i + 1) or i + 2 >= tokens.size() or tokens[i + 2] != "=") {
+        // using-declarations and using-directives don't declare anything new
+        return std::nullopt;
+      }
+      declaration.directive = "cpp:type";
+      declaration.kind = is_template ? "TYPE_ALIAS_TEMPLATE_DECL" : "TYPE_ALIAS_DECL";
+    } else {
+      declaration.opens_struct = false;
+
+      size_t open_paren = i, equals = i;
+      while (open_paren < tokens.size() and tokens[open_paren] != "(") ++open_paren;
+      while (equals < tokens.size() and tokens[equals] != "=") ++equals;
+
+      if (open_paren < equals) {
+        // function; the name is right before its parameters
+        if (open_paren == i or not is_name(open_paren - 1)) return std::nullopt;
+        if (open_paren + 1 < tokens.size()
+            and (tokens[open_paren + 1] == "*" or tokens[open_paren + 1] == "&")) {
+          // a pointer or reference to function is a variable
+          return std::nullopt;
+        }
+        if (open_paren - 1 > i and tokens[open_paren - 2] == ":") {
+          // qualified names are defined out of their semantic parent
+          return std::nullopt;
+        }
+        if (in_struct and tokens[open_paren - 1] == _scopes.back().name) {
+          // constructor
+          return std::nullopt;
+        }
+        declaration.directive = "cpp:function";
+        declaration.kind = is_template ? "FUNCTION_TEMPLATE"
+                         : in_struct   ? "CXX_METHOD"
+                                       : "FUNCTION_DECL";
+      } else {
+        if (is_template) return std::nullopt;
+        // a type and a name at least
+        if (not is_name(i) or not is_name(i + 1)) return std::nullopt;
+        declaration.directive = in_struct ? "cpp:member" : "cpp:var";
+        declaration.kind = in_struct ? "FIELD_DECL" : "VAR_DECL";
+      }
+    }
+
+    std::vector<Token> kept;
+    for (auto token : tokens) {
+      if (not OMITTED.contains(token.view())) kept.push_back(token);
+    }
+    declaration.argument = join(kept);
+    return declaration;
+  }
+
+  void open_scope() {
+    auto documented = std::move(_documented_struct);
+    _documented_struct.reset();
+
+    auto &scope = _scopes.emplace_back(Scope::OPAQUE);
+    auto &tokens = _statement;
+    size_t i = 0;
+    if (i < tokens.size() and tokens[i] == "export") ++i;
+
+    if (i < tokens.size() and tokens[i] == "inline") ++i;
+    if (i < tokens.size() and tokens[i] == "namespace") {
+      std::string name;
+      for (++i; i < tokens.size(); ++i) name += tokens[i].view();
+      if (name.empty()) return;  // anonymous namespaces are opaque
+      scope = {Scope::NAMESPACE, name, name};
+      return;
+    }
+
+    if (i + 1 < tokens.size() and tokens[i] == "extern" and *tokens[i + 1].begin == '"') {
+      scope.kind = Scope::TRANSPARENT;
+      return;
+    }
+
+    if (i < tokens.size() and tokens[i] == "template") {
+      for (int depth = 0; i < tokens.size(); ++i) {
+        if (tokens[i] == "<") ++depth;
+        if (tokens[i] == ">" and --depth == 0) break;
+      }
+      ++i;
+    }
+    if (i + 1 < tokens.size() and (tokens[i] == "struct" or tokens[i] == "class")
+        and is_identifier_char(*tokens[i + 1].begin)) {
+      std::string name{tokens[i + 1].view()};
+      scope = {Scope::STRUCT, documented ? *documented : name, name};
+    }
+  }
+
+  char const *_s;
+  char const *_line_position;
+  int _line = 1;
+  int _skip_until_line = 0;
+
+  std::string _file;
+  FileContent _file_content;
+  std::vector<Scope> _scopes;
+  std::vector<Token> _statement;
+  std::optional<std::string> _documented_struct;
+};
+
+std::optional<FileContent> extract_apidoc(std::string file, char const *source) {
+  return Extractor{std::move(file), source}.extract();
+}
+
+void write_json(std::ostream &os, Comment const &comment) {
+  os << "{\"file\": ";
+  write_json_string(os, comment.file);
+  os << ", \"next_line\": " << comment.next_line << ", \"text\": [";
+  for (bool first = true; auto const &line : comment.text) {
+    if (not std::exchange(first, false)) os << ", ";
+    write_json_string(os, line);
+  }
+  os << "], \"clang_cursor_kind\": ";
+  write_json_string(os, comment.clang_cursor_kind);
+  os << "}";
+}
+
+void write_json(std::ostream &os, FileContent const &file_content) {
+  os << "{\n  \"module\": ";
+  write_json_string(os, file_content.module);
+
+  os << ",\n  \"floating_comments\": [";
+  for (bool first = true; auto const &comment : file_content.floating_comments) {
+    os << (std::exchange(first, false) ? "\n    " : ",\n    ");
+    write_json(os, comment);
+  }
+
+  os << "\n  ],\n  \"directive_comments\": [";
+  for (bool first = true; auto const &[directive, argument, namespace_name, comment] :
+                          file_content.directive_comments) {
+    os << (std::exchange(first, false) ? "\n    [" : ",\n    [");
+    write_json_string(os, directive);
+    os << ", ";
+    write_json_string(os, argument);
+    os << ", ";
+    write_json_string(os, namespace_name);
+    os << ", ";
+    write_json(os, comment);
+    os << "]";
+  }
+
+  os << "\n  ],\n  \"clang_diagnostics\": [],\n  \"mtime_when_parsed\": "
+     << std::setprecision(17) << file_content.mtime_when_parsed << "\n}\n";
+}
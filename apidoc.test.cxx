@@ -0,0 +1,46 @@
+#include <string>
+#include <string_view>
+import test_;
+import maud_;
+
+auto const CASES = Parameter::read_file(DIR / "apidoc.test.yaml");
+
+TEST_(extraction, CASES) {
+  auto source = std::string(to_view(parameter["source"]));
+  auto file_content = extract_apidoc("source.cxx", source.c_str());
+
+  if (parameter.has_child("fallback")) {
+    EXPECT_(not file_content.has_value());
+    return;
+  }
+  if (not EXPECT_(file_content.has_value())) return;
+
+  auto floating = parameter["floating"];
+  if (EXPECT_(file_content->floating_comments.size() == floating.num_children())) {
+    for (size_t i = 0; auto next_line : floating) {
+      EXPECT_(std::to_string(file_content->floating_comments[i++].next_line)
+              == to_view(next_line));
+    }
+  }
+
+  auto documented = parameter["documented"];
+  if (not EXPECT_(file_content->directive_comments.size() == documented.num_children())) {
+    return;
+  }
+  for (size_t i = 0; auto expected : documented) {
+    auto const &[directive, argument, namespace_name, comment] =
+        file_content->directive_comments[i++];
+    EXPECT_(directive == to_view(expected[0]));
+    EXPECT_(argument == to_view(expected[1]));
+    EXPECT_(namespace_name == to_view(expected[2]));
+    EXPECT_(comment.clang_cursor_kind == to_view(expected[3]));
+    EXPECT_(std::to_string(comment.next_line) == to_view(expected[4]));
+    EXPECT_(comment.file == "source.cxx");
+
+    if (expected.num_children() < 6) continue;
+    if (not EXPECT_(comment.text.size() == expected[5].num_children())) continue;
+    for (size_t j = 0; auto line : expected[5]) {
+      EXPECT_(comment.text[j++] == to_view(line));
+    }
+  }
+}
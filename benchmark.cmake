@@ -0,0 +1,42 @@
+# maud_benchmark measures how configuring and building scale with the size of a
+# project, using projects written by maud_synthesize. Each scale multiplies the
+# number of modules, executables, tests, templates, and options. Results are
+# written to ${CMAKE_BINARY_DIR}/benchmark/results.json
+set(MAUD_BENCHMARK_SCALES 1 4 16)
+
+# maud_synthesize is only defined once sources are scanned, after this file is included
+function(add_benchmark)
+  if(NOT TARGET maud_synthesize)
+    return()
+  endif()
+  list(JOIN MAUD_BENCHMARK_SCALES "," scales)
+  add_custom_target(
+    maud_benchmark
+    COMMAND
+    "${CMAKE_COMMAND}"
+    -D "MAUD_BUILD_DIR=${CMAKE_BINARY_DIR}"
+    -D "CONFIG=$<CONFIG>"
+    -D "CXX=${CMAKE_CXX_COMPILER}"
+    -D "SYNTHESIZE=$<TARGET_FILE:maud_synthesize>"
+    -D "SCALES=${scales}"
+    -D "OUTPUT_DIR=${CMAKE_BINARY_DIR}/benchmark"
+    -P "${CMAKE_SOURCE_DIR}/cmake_modules/maud_benchmark.cmake"
+    COMMENT "Benchmarking synthesized projects, writing benchmark/results.json"
+    USES_TERMINAL
+    VERBATIM
+  )
+
+  # Maud is installed from this build directory to benchmark it, so everything
+  # which would be installed must be built first.
+  get_property(targets DIRECTORY PROPERTY BUILDSYSTEM_TARGETS)
+  foreach(target ${targets})
+    get_target_property(type ${target} TYPE)
+    if(
+      type MATCHES "^(EXECUTABLE|STATIC_LIBRARY|SHARED_LIBRARY|OBJECT_LIBRARY)$"
+      AND NOT target MATCHES "^test_"
+    )
+      add_dependencies(maud_benchmark ${target})
+    endif()
+  endforeach()
+endfunction()
+cmake_language(DEFER CALL add_benchmark)
@@ -0,0 +1,291 @@
+// Boost Licensed
+//
+module;
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+export module maud_:build_report;
+import :parsing;
+import :yaml;
+
+using std::chrono::milliseconds;
+
+// A single translation unit of the module graph, as written to module_graph.json
+export struct Unit {
+  std::string source, target, type, module, partition, object;
+  std::vector<std::string> imports;
+  // How long the unit took to compile in the most recent build, if known
+  std::optional<milliseconds> duration;
+
+  // The name importers use for this unit, or "" if it provides nothing
+  std::string logical_name() const {
+    if (type != "INTERFACE" and type != "PROVIDER") return "";
+    return partition.empty() ? module : module + ":" + partition;
+  }
+};
+
+export std::vector<Unit> read_module_graph(char *json) {
+  auto tree = parse_in_place(json);
+  std::vector<Unit> units;
+  for (auto node : tree.rootref()) {
+    auto &unit = units.emplace_back();
+    unit.source = to_string(node["source"]);
+    unit.target = to_string(node["target"]);
+    unit.type = to_string(node["type"]);
+    unit.module = to_string(node["module"]);
+    unit.partition = to_string(node["partition"]);
+    unit.object = to_string(node["object"]);
+    for (auto import : node["imports"]) unit.imports.push_back(to_string(import));
+  }
+  return units;
+}
+
+// Fill in each unit's duration from a .ninja_log. Lines are
+//
+//   START END MTIME OUTPUT HASH
+//
+// with times in milliseconds, and a later line for an output supersedes earlier
+// ones. CMake names objects CMakeFiles/TARGET.dir/[CONFIG/]OBJECT, so with more
+// than one configuration the most recently compiled object wins.
+export void read_ninja_log(std::string_view log, std::vector<Unit> &units) {
+  std::map<std::string, Unit *, std::less<>> by_object;
+  for (auto &unit : units) by_object[unit.target + ".dir/" + unit.object] = &unit;
+
+  auto lookup = [&](std::string_view target_dir, std::string_view object) -> Unit * {
+    std::string key{target_dir};
+    key += object;
+    auto it = by_object.find(key);
+    return it == by_object.end() ? nullptr : it->second;
+  };
+
+  while (not log.empty()) {
+    auto line = log.substr(0, log.find('\n'));
+    log.remove_prefix(std::min(log.size(), line.size() + 1));
+    if (line.starts_with("#")) continue;
+
+    std::string_view fields[4];
+    for (auto &field : fields) {
+      auto tab = line.find('\t');
+      field = line.substr(0, tab);
+      line.remove_prefix(std::min(line.size(), field.size() + 1));
+    }
+    auto [start, end, output] = std::tuple{fields[0], fields[1], fields[3]};
+
+    constexpr std::string_view PREFIX = "CMakeFiles/";
+    if (not output.starts_with(PREFIX)) continue;
+    output.remove_prefix(PREFIX.size());
+    auto dir_end = output.find(".dir/");
+    if (dir_end == std::string_view::npos) continue;
+    auto target_dir = output.substr(0, dir_end + 5);
+    output.remove_prefix(target_dir.size());
+
+    auto *unit = lookup(target_dir, output);
+    auto slash = output.find('/');
+    if (unit == nullptr and slash != std::string_view::npos) {
+      unit = lookup(target_dir, output.substr(slash + 1));
+    }
+    if (unit == nullptr) continue;
+
+    // Lines which don't parse (for example one truncated by an interrupted build)
+    // are skipped.
+    auto parse = [](std::string_view field, long long &value) {
+      auto [ptr, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+      return ec == std::errc{} and ptr == field.data() + field.size();
+    };
+    long long start_ms, end_ms;
+    if (not parse(start, start_ms) or not parse(end, end_ms)) continue;
+    unit->duration = milliseconds{end_ms - start_ms};
+  }
+}
+
+export struct FanOut {
+  size_t unit;
+  // Every unit which must be recompiled when this one's interface changes
+  size_t dependents = 0;
+  milliseconds dependent_duration{};
+};
+
+export struct BuildReport {
+  // For each unit, the units whose BMIs it imports
+  std::vector<std::vector<size_t>> dependencies;
+  // Units on the longest chain of BMI dependencies, first to last
+  std::vector<size_t> critical_path;
+  milliseconds critical_duration{}, total_duration{};
+  // Every unit which provides a BMI, most dependents first
+  std::vector<FanOut> fan_out;
+  // Units which are part of an import cycle, or have no recorded duration
+  std::vector<size_t> cyclic, untimed;
+
+  // The speedup over a serial build which unlimited jobs could achieve
+  double parallelism() const {
+    if (critical_duration.count() == 0) return 1;
+    return static_cast<double>(total_duration.count()) / critical_duration.count();
+  }
+};
+
+export BuildReport analyze(std::vector<Unit> const &units) {
+  BuildReport report;
+  size_t const N = units.size();
+
+  std::map<std::string, size_t, std::less<>> providers;
+  for (size_t i = 0; i < N; ++i) {
+    if (auto name = units[i].logical_name(); not name.empty()) providers.emplace(name, i);
+  }
+
+  report.dependencies.resize(N);
+  std::vector<std::vector<size_t>> dependents(N);
+  std::vector<size_t> unresolved(N);
+  for (size_t i = 0; i < N; ++i) {
+    for (auto const &import : units[i].imports) {
+      auto it = providers.find(import);
+      if (it == providers.end() or it->second == i) continue;
+      report.dependencies[i].push_back(it->second);
+      dependents[it->second].push_back(i);
+      ++unresolved[i];
+    }
+  }
+
+  auto duration = [&](size_t i) { return units[i].duration.value_or(milliseconds{}); };
+
+  // Visit units in topological order, so that each unit's earliest finish is
+  // known before any of its dependents is visited.
+  std::vector<milliseconds> finish(N);
+  std::vector<size_t> predecessor(N, N);
+  std::queue<size_t> ready;
+  for (size_t i = 0; i < N; ++i) {
+    report.total_duration += duration(i);
+    if (not units[i].duration) report.untimed.push_back(i);
+    if (unresolved[i] == 0) ready.push(i);
+  }
+  size_t visited = 0;
+  while (not ready.empty()) {
+    size_t i = ready.front();
+    ready.pop();
+    ++visited;
+    finish[i] += duration(i);
+    for (size_t d : dependents[i]) {
+      if (finish[d] <= finish[i]) {
+        finish[d] = finish[i];
+        predecessor[d] = i;
+      }
+      if (--unresolved[d] == 0) ready.push(d);
+    }
+  }
+  if (visited != N) {
+    for (size_t i = 0; i < N; ++i) {
+      if (unresolved[i] != 0) report.cyclic.push_back(i);
+    }
+  }
+
+  if (N != 0) {
+    size_t last = std::max_element(finish.begin(), finish.end()) - finish.begin();
+    report.critical_duration = finish[last];
+    for (size_t i = last; i != N; i = predecessor[i]) report.critical_path.push_back(i);
+    std::reverse(report.critical_path.begin(), report.critical_path.end());
+  }
+
+  std::vector<size_t> seen(N, N);
+  for (auto const &[name, provider] : providers) {
+    auto &fan_out = report.fan_out.emplace_back(FanOut{provider});
+    std::vector<size_t> stack{dependents[provider]};
+    while (not stack.empty()) {
+      size_t i = stack.back();
+      stack.pop_back();
+      if (std::exchange(seen[i], provider) == provider) continue;
+      ++fan_out.dependents;
+      fan_out.dependent_duration += duration(i);
+      stack.insert(stack.end(), dependents[i].begin(), dependents[i].end());
+    }
+  }
+  std::stable_sort(report.fan_out.begin(), report.fan_out.end(),
+                   [](FanOut const &l, FanOut const &r) {
+                     return std::pair{l.dependents, l.dependent_duration}
+                          > std::pair{r.dependents, r.dependent_duration};
+                   });
+  return report;
+}
+
+std::string display_name(Unit const &unit) {
+  if (auto name = unit.logical_name(); not name.empty()) return name;
+  return unit.object.substr(0, unit.object.rfind('.'));
+}
+
+export void write_json(std::ostream &os, std::vector<Unit> const &units,
+                       BuildReport const &report) {
+  auto write_unit = [&](size_t i) {
+    os << "{\"name\": ";
+    write_json_string(os, display_name(units[i]));
+    os << ", \"source\": ";
+    write_json_string(os, units[i].source);
+    os << ", \"ms\": " << units[i].duration.value_or(milliseconds{}).count();
+  };
+  auto write_units = [&](std::vector<size_t> const &indices) {
+    if (indices.empty()) {
+      os << "[]";
+      return;
+    }
+    os << "[";
+    for (bool first = true; size_t i : indices) {
+      os << (std::exchange(first, false) ? "\n    " : ",\n    ");
+      write_unit(i);
+      os << "}";
+    }
+    os << "\n  ]";
+  };
+
+  os << "{\n  \"total_ms\": " << report.total_duration.count();
+  os << ",\n  \"critical_path_ms\": " << report.critical_duration.count();
+  os << ",\n  \"parallelism\": " << report.parallelism();
+  os << ",\n  \"critical_path\": ";
+  write_units(report.critical_path);
+  os << ",\n  \"fan_out\": [";
+  for (bool first = true; auto const &fan_out : report.fan_out) {
+    os << (std::exchange(first, false) ? "\n    " : ",\n    ");
+    write_unit(fan_out.unit);
+    os << ", \"dependents\": " << fan_out.dependents
+       << ", \"dependent_ms\": " << fan_out.dependent_duration.count() << "}";
+  }
+  os << "\n  ],\n  \"cyclic\": ";
+  write_units(report.cyclic);
+  os << ",\n  \"untimed\": ";
+  write_units(report.untimed);
+  os << "\n}\n";
+}
+
+// Write the module graph in graphviz format, with edges from each BMI to its
+// importers and the critical path highlighted.
+export void write_dot(std::ostream &os, std::vector<Unit> const &units,
+                      BuildReport const &report) {
+  // For each unit on the critical path, the unit before it (or N for the first)
+  size_t const N = units.size();
+  std::vector<size_t> critical(N, N + 1);
+  for (size_t previous = N; size_t i : report.critical_path) {
+    critical[i] = std::exchange(previous, i);
+  }
+
+  os << "digraph modules {\n  rankdir=LR;\n  node [shape=box];\n";
+  for (size_t i = 0; i < N; ++i) {
+    os << "  u" << i << " [label=";
+    auto duration = std::to_string(units[i].duration.value_or(milliseconds{}).count());
+    write_json_string(os, display_name(units[i]) + "\n" + duration + "ms");
+    if (critical[i] != N + 1) os << ", color=red, penwidth=2";
+    os << "];\n";
+  }
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t d : report.dependencies[i]) {
+      os << "  u" << d << " -> u" << i;
+      if (critical[i] == d) os << " [color=red, penwidth=2]";
+      os << ";\n";
+    }
+  }
+  os << "}\n";
+}
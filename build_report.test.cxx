@@ -0,0 +1,90 @@
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+import test_;
+import maud_;
+
+using std::chrono::milliseconds;
+
+auto const GRAPH = R"([
+  {"source": "a.cxx", "target": "foo", "type": "INTERFACE", "module": "foo",
+   "partition": "", "object": "a.cxx.o", "imports": ["foo:x", "foo:y"]},
+  {"source": "x.cxx", "target": "foo", "type": "INTERFACE", "module": "foo",
+   "partition": "x", "object": "x.cxx.o", "imports": []},
+  {"source": "y.cxx", "target": "foo", "type": "PROVIDER", "module": "foo",
+   "partition": "y", "object": "y.cxx.o", "imports": ["foo:x"]},
+  {"source": "main.cxx", "target": "main", "type": "", "module": "",
+   "partition": "", "object": "main.cxx.o", "imports": ["foo", "executable"]}
+])";
+
+auto const NINJA_LOG = "# ninja log v5\n"
+                       "0\t100\t0\tCMakeFiles/foo.dir/Debug/x.cxx.o\t1\n"
+                       "0\t50\t0\tCMakeFiles/foo.dir/Debug/x.cxx.o.ddi\t2\n"
+                       "100\t400\t0\tCMakeFiles/foo.dir/Debug/y.cxx.o\t3\n"
+                       "100\t150\t0\tCMakeFiles/foo.dir/Debug/x.cxx.o\t4\n"
+                       "100\t400\t0\tCMakeFiles/foo.dir/Debug/x.cxx.o\t4\n"
+                       "400\t500\t0\tCMakeFiles/foo.dir/Release/a.cxx.o\t5\n";
+
+std::vector<Unit> units() {
+  std::string graph = GRAPH;
+  auto units = read_module_graph(graph.data());
+  read_ninja_log(NINJA_LOG, units);
+  return units;
+}
+
+TEST_(ninja_log) {
+  auto units = ::units();
+  if (not EXPECT_(units.size() == 4)) return;
+  // The last entry for an object wins
+  EXPECT_(units[1].duration == milliseconds{300});
+  EXPECT_(units[2].duration == milliseconds{300});
+  EXPECT_(units[0].duration == milliseconds{100});
+  EXPECT_(not units[3].duration.has_value());
+}
+
+TEST_(malformed_ninja_log) {
+  auto units = ::units();
+  read_ninja_log("0\tx\t0\tCMakeFiles/foo.dir/Debug/a.cxx.o\t6\n"
+                 "0\t100000000000000000000\t0\tCMakeFiles/foo.dir/Debug/x.cxx.o\t7\n"
+                 "0\t",
+                 units);
+  EXPECT_(units[0].duration == milliseconds{100});
+  EXPECT_(units[1].duration == milliseconds{300});
+}
+
+TEST_(critical_path) {
+  auto units = ::units();
+  auto report = analyze(units);
+  EXPECT_(report.critical_path == std::vector<size_t>{1, 2, 0, 3});
+  EXPECT_(report.critical_duration == milliseconds{700});
+  EXPECT_(report.total_duration == milliseconds{700});
+  EXPECT_(report.untimed == std::vector<size_t>{3});
+  EXPECT_(report.cyclic.empty());
+}
+
+TEST_(fan_out) {
+  auto report = analyze(::units());
+  if (not EXPECT_(report.fan_out.size() == 3)) return;
+  EXPECT_(report.fan_out[0].unit == 1);
+  EXPECT_(report.fan_out[0].dependents == 3);
+  EXPECT_(report.fan_out[0].dependent_duration == milliseconds{400});
+  EXPECT_(report.fan_out[2].unit == 0);
+  EXPECT_(report.fan_out[2].dependents == 1);
+}
+
+TEST_(import_cycle) {
+  std::string graph = R"([
+    {"source": "a.cxx", "target": "m", "type": "INTERFACE", "module": "m",
+     "partition": "a", "object": "a.cxx.o", "imports": ["m:b"]},
+    {"source": "b.cxx", "target": "m", "type": "INTERFACE", "module": "m",
+     "partition": "b", "object": "b.cxx.o", "imports": ["m:a"]}
+  ])";
+  auto units = read_module_graph(graph.data());
+  auto report = analyze(units);
+  EXPECT_(report.cyclic == std::vector<size_t>{0, 1});
+
+  std::stringstream dot;
+  write_dot(dot, units, report);
+  EXPECT_(dot.str().find("u1 -> u0") != std::string::npos);
+}
@@ -14,6 +14,19 @@ function(_maud_set var)
 endfunction()
 
 
+# Write a file only if its content would change, so that files which are build
+# inputs keep their mtimes across reconfigurations with unchanged content.
+function(_maud_write_if_different path content)
+  if(EXISTS "${path}")
+    file(READ "${path}" old)
+    if(old STREQUAL content)
+      return()
+    endif()
+  endif()
+  file(WRITE "${path}" "${content}")
+endfunction()
+
+
 function(_maud_set_include var)
   set(val ${${var}} ${ARGN})
   list(REMOVE_DUPLICATES val)
@@ -188,9 +201,37 @@ function(_maud_write_scan_script source_file)
   else()
     set(arg "$1")
   endif()
+
+  # The compiler can't scan imports of header units which haven't been built yet,
+  # so these sources are scanned by maud_scan instead. Conditions which maud_scan
+  # can't decide are assumed to be taken.
+  _maud_header_unit_imports("${source_file}" header_units)
+  if(header_units AND NOT _MAUD_SCAN)
+    find_program(_MAUD_SCAN maud_scan REQUIRED)
+  endif()
+
+  # The flags which the source's target adds are written by _maud_scan_flags
+  if(NOT EXISTS "${ddi_path}.flags")
+    file(WRITE "${ddi_path}.flags" "")
+  endif()
+
+  set(maud_scan "\"${_MAUD_SCAN}\" \"@${MAUD_DIR}/scan.args\"")
+  set(maud_scan "${maud_scan} --flags \"@${ddi_path}.flags\" --end-flags")
+  set(maud_scan "${maud_scan} \"${source_file}\" \"${ddi_path}${arg}\"")
+
+  if(header_units)
+    string(REPLACE "\" \"@" "\" --take-undecided \"@" scan "${maud_scan}")
+    if(MSVC)
+      _maud_write_if_different("${ddi_path}.scan.bat" "${scan}\n")
+    else()
+      _maud_write_if_different("${ddi_path}.scan.sh" "${scan}\n")
+    endif()
+    return()
+  endif()
+
   set(scan "${CMAKE_CXX_SCANDEP_SOURCE}\n")
   string(REPLACE <CMAKE_CXX_COMPILER> "\"${CMAKE_CXX_COMPILER}\"" scan "${scan}")
-  string(REPLACE <FLAGS> "${flags}" scan "${scan}")
+  string(REPLACE <FLAGS> "${flags} \"@${ddi_path}.flags\"" scan "${scan}")
   string(REPLACE <DEFINES> "" scan "${scan}")
   string(REPLACE <INCLUDES> "" scan "${scan}")
   string(REPLACE <SOURCE> "\"${source_file}\"" scan "${scan}")
@@ -198,11 +239,176 @@ function(_maud_write_scan_script source_file)
   string(REPLACE <DEP_FILE> "\"${ddi_path}.d\"" scan "${scan}")
   string(REPLACE <DYNDEP_FILE> "\"${ddi_path}${arg}\"" scan "${scan}")
   string(REPLACE <PREPROCESSED_SOURCE> "\"${ddi_path}.preprocessed\"" scan "${scan}")
+
+  # Unless its preprocessing scan options say otherwise, try maud_scan first. If it
+  # can't decide a condition which an import depends on, the compiler scans instead.
+  # Nor if its target has flags which can't be evaluated yet (see _maud_scan_flags).
+  get_source_file_property(options "${source_file}" MAUD_PREPROCESSING_SCAN_OPTIONS)
+  get_source_file_property(unevaluated "${source_file}" _MAUD_UNEVALUATED_FLAGS)
+  if(_MAUD_SCAN AND NOT options AND NOT unevaluated)
+    if(MSVC)
+      set(scan "${maud_scan} && exit /b 0\n${scan}")
+    else()
+      set(scan "${maud_scan} && exit 0\n${scan}")
+    endif()
+  endif()
+
   if(MSVC)
-    file(WRITE "${ddi_path}.scan.bat" "${scan}\n")
+    _maud_write_if_different("${ddi_path}.scan.bat" "${scan}\n")
   else()
-    file(WRITE "${ddi_path}.scan.sh" "${scan}\n")
+    _maud_write_if_different("${ddi_path}.scan.sh" "${scan}\n")
+  endif()
+endfunction()
+
+
+# maud_scan decides preprocessing conditionals using the macros which are known
+# before any target exists: those which the compiler predefines (macros which differ
+# between configurations are left unknown), the directory's compile definitions, and
+# option macros. These are written once to an arguments file shared by every scan.
+# The predefined macros are listed with the directory's flags, which are recorded as
+# baseline flags; maud_scan ignores them for sources compiled with any other flags
+# which might change them (see _maud_scan_flags).
+function(_maud_write_scan_arguments)
+  find_program(_MAUD_SCAN maud_scan)
+  mark_as_advanced(_MAUD_SCAN)
+  if(NOT _MAUD_SCAN)
+    return()
+  endif()
+
+  set(args "")
+  _maud_scan_options(DIRECTORY "" COMPILE_OPTIONS directory_options)
+  if(directory_options MATCHES "[$]<")
+    # These can't be evaluated yet, so the predefined macros can't be listed
+    message(VERBOSE "Not listing predefined macros for generator expression options")
+  elseif(CMAKE_CXX_COMPILER_ID MATCHES "Clang|GNU")
+    _maud_cxx_standard_option(std)
+    _maud_write_if_different("${MAUD_DIR}/predefined_macros/empty.cxx" "")
+    _maud_configuration_types(configs)
+    if(NOT configs)
+      set(configs none)
+    endif()
+    foreach(config ${configs})
+      string(TOUPPER "${config}" CONFIG)
+      separate_arguments(
+        flags NATIVE_COMMAND
+        "${CMAKE_CXX_FLAGS} ${CMAKE_CXX_FLAGS_${CONFIG}}"
+      )
+      list(APPEND flags ${directory_options})
+      execute_process(
+        COMMAND "${CMAKE_CXX_COMPILER}" ${std} ${flags}
+          -dM -E "${MAUD_DIR}/predefined_macros/empty.cxx"
+        OUTPUT_VARIABLE macros
+        RESULT_VARIABLE failed
+        ERROR_QUIET
+      )
+      if(failed)
+        message(VERBOSE "Could not list predefined macros for ${config}")
+        continue()
+      endif()
+      _maud_write_if_different("${MAUD_DIR}/predefined_macros/${config}.h" "${macros}")
+      string(APPEND args "--predefined\n${MAUD_DIR}/predefined_macros/${config}.h\n")
+      foreach(flag ${std} ${flags})
+        string(APPEND args "--baseline-flag\n${flag}\n")
+      endforeach()
+    endforeach()
+  endif()
+
+  get_directory_property(definitions COMPILE_DEFINITIONS)
+  foreach(definition ${definitions})
+    if(NOT definition MATCHES "[$]<")
+      string(APPEND args "-D${definition}\n")
+    endif()
+  endforeach()
+
+  get_property(macros GLOBAL PROPERTY _MAUD_OPTION_MACROS)
+  set(options)
+  foreach(macro ${macros})
+    get_property(option GLOBAL PROPERTY _MAUD_OPTION_OF_${macro})
+    list(APPEND options ${option})
+  endforeach()
+  list(REMOVE_DUPLICATES options)
+  foreach(option ${options})
+    string(APPEND args "--macros\n${MAUD_DIR}/options/${option}.h\n")
+  endforeach()
+
+  get_directory_property(dirs INCLUDE_DIRECTORIES)
+  foreach(dir ${dirs} ${CMAKE_CXX_IMPLICIT_INCLUDE_DIRECTORIES})
+    string(APPEND args "-I${dir}\n")
+  endforeach()
+
+  # These are always scanned by the compiler, including in the build
+  foreach(source_file ${_MAUD_CXX_SCANNED_SOURCES})
+    get_source_file_property(options "${source_file}" MAUD_PREPROCESSING_SCAN_OPTIONS)
+    if(options)
+      string(APPEND args "--compiler-scan\n${source_file}\n")
+    endif()
+  endforeach()
+
+  _maud_write_if_different("${MAUD_DIR}/scan.args" "${args}")
+endfunction()
+
+
+# The header units which a source imports, as spelled (like <vector>). Only sources
+# with a line which looks like such an import are scanned for them; the scan skips
+# imports in comments and in groups which are known to be excluded.
+function(_maud_header_unit_imports source_file out_var)
+  file(
+    STRINGS "${source_file}" lines
+    REGEX "^[ \t]*(export[ \t]+)?import[ \t]*[<\"]"
+  )
+  set(${out_var} "" PARENT_SCOPE)
+  if(NOT lines)
+    return()
+  endif()
+
+  if(NOT _MAUD_SCAN)
+    find_program(_MAUD_SCAN maud_scan REQUIRED)
+  endif()
+  _maud_get_ddi_path("${source_file}" ddi_path)
+  set(ddi_path "${ddi_path}.header_units")
+  execute_process(
+    COMMAND
+    "${_MAUD_SCAN}" --take-undecided "@${MAUD_DIR}/scan.args" "${source_file}" "${ddi_path}"
+    RESULT_VARIABLE result
+  )
+  if(NOT result EQUAL 0 OR NOT EXISTS "${ddi_path}")
+    # Assume every such line is an import, so the source is scanned by maud_scan
+    set(${out_var} "${lines}" PARENT_SCOPE)
+    return()
   endif()
+  file(READ "${ddi_path}" ddi)
+  file(REMOVE "${ddi_path}")
+  _maud_ddi_requires("${ddi}" imports header_units)
+  set(${out_var} "${header_units}" PARENT_SCOPE)
+endfunction()
+
+
+# The modules which a DDI requires, separating header units (which are looked up
+# like includes, and are listed as spelled)
+function(_maud_ddi_requires ddi out_imports out_header_units)
+  set(imports "")
+  set(header_units "")
+  string(JSON requires_count ERROR_VARIABLE error LENGTH "${ddi}" rules 0 requires)
+  if(error)
+    set(requires_count 0)
+  endif()
+  math(EXPR last_require "${requires_count} - 1")
+  foreach(i RANGE ${last_require})
+    if(requires_count EQUAL 0)
+      break()
+    endif()
+    string(JSON name GET "${ddi}" rules 0 requires ${i} logical-name)
+    string(JSON lookup ERROR_VARIABLE error GET "${ddi}" rules 0 requires ${i} lookup-method)
+    if(lookup STREQUAL "include-angle")
+      list(APPEND header_units "<${name}>")
+    elseif(lookup STREQUAL "include-quote")
+      list(APPEND header_units "\"${name}\"")
+    else()
+      list(APPEND imports "${name}")
+    endif()
+  endforeach()
+  set(${out_imports} "${imports}" PARENT_SCOPE)
+  set(${out_header_units} "${header_units}" PARENT_SCOPE)
 endfunction()
 
 
@@ -265,9 +471,216 @@ function(_maud_cxx_sources)
   endif()
   _maud_set(_MAUD_CXX_SCANNED_SOURCES "${_MAUD_CXX_SOURCES}")
 
+  _maud_write_scan_arguments()
   foreach(source_file ${_MAUD_CXX_SCANNED_SOURCES})
     _maud_scan("${source_file}")
   endforeach()
+  _maud_header_units()
+
+  _maud_build_scan_rule(scan)
+  if(scan)
+    set(CMAKE_CXX_SCANDEP_SOURCE "${scan}" PARENT_SCOPE)
+  endif()
+endfunction()
+
+
+# CMake scans module sources again while building, to produce the dyndep
+# information ninja needs. maud_scan can do that too, so the compiler's scan rule
+# only runs for sources which maud_scan can't scan (as at configure time).
+# The flags which TARGET and SOURCE add to those the predefined macros were listed
+# with. If these change, the source is scanned again (so that for example a target
+# compiled with -fno-exceptions isn't scanned as though __cpp_exceptions is defined).
+# Flags with generator expressions can't be evaluated yet, so they are omitted and
+# the source's _MAUD_UNEVALUATED_FLAGS property is set.
+function(_maud_scan_flags target source_file out_var)
+  _maud_scan_options(TARGET ${target} COMPILE_OPTIONS flags)
+  _maud_scan_options(SOURCE "${source_file}" COMPILE_OPTIONS source_flags)
+  list(APPEND flags ${source_flags})
+
+  get_target_property(standard ${target} CXX_STANDARD)
+  if(standard AND NOT standard STREQUAL CMAKE_CXX_STANDARD)
+    set(CMAKE_CXX_STANDARD ${standard})
+    _maud_cxx_standard_option(std)
+    list(APPEND flags ${std})
+  endif()
+
+  get_target_property(libraries ${target} LINK_LIBRARIES)
+  foreach(library ${libraries})
+    if(TARGET ${library})
+      _maud_scan_options(TARGET ${library} INTERFACE_COMPILE_OPTIONS library_flags)
+      list(APPEND flags ${library_flags})
+    endif()
+  endforeach()
+
+  get_target_property(definitions ${target} COMPILE_DEFINITIONS)
+  foreach(definition ${definitions})
+    if(definition AND NOT definition MATCHES "[$]<")
+      list(APPEND flags "-D${definition}")
+    endif()
+  endforeach()
+
+  set(unevaluated "${flags}")
+  list(FILTER flags EXCLUDE REGEX "[$]<")
+  list(FILTER unevaluated INCLUDE REGEX "[$]<")
+  if(unevaluated)
+    set_source_files_properties(${source_file} PROPERTIES _MAUD_UNEVALUATED_FLAGS ON)
+  endif()
+  set(${out_var} "${flags}" PARENT_SCOPE)
+endfunction()
+
+
+# Read a compile options property, omitting the force included option headers
+# (whose macros maud_scan reads with --macros) and expanding SHELL: options.
+function(_maud_scan_options kind name property out_var)
+  if(kind STREQUAL "DIRECTORY")
+    get_directory_property(options ${property})
+  else()
+    get_property(options ${kind} "${name}" PROPERTY ${property})
+  endif()
+  set(flags "")
+  foreach(option ${options})
+    string(FIND "${option}" "${_MAUD_INCLUDE}" include)
+    if(include EQUAL 0)
+      continue()
+    endif()
+    if(option MATCHES "^SHELL:(.*)$")
+      separate_arguments(option NATIVE_COMMAND "${CMAKE_MATCH_1}")
+    endif()
+    list(APPEND flags ${option})
+  endforeach()
+  set(${out_var} "${flags}" PARENT_SCOPE)
+endfunction()
+
+
+function(_maud_build_scan_rule out_var)
+  set(${out_var} "" PARENT_SCOPE)
+  # The fallback to the compiler's scan needs a POSIX shell
+  if(NOT _MAUD_SCAN OR NOT CMAKE_CXX_SCANDEP_SOURCE OR CMAKE_HOST_WIN32)
+    return()
+  endif()
+  string(
+    CONCAT rule
+    "\"${_MAUD_SCAN}\" \"@${MAUD_DIR}/scan.args\""
+    " --flags <DEFINES> <FLAGS> --end-flags"
+    " --object <OBJECT> --dep-file <DEP_FILE> <SOURCE> <DYNDEP_FILE>"
+    " || ( ${CMAKE_CXX_SCANDEP_SOURCE} )"
+  )
+  set(${out_var} "${rule}" PARENT_SCOPE)
+endfunction()
+
+
+# Build each header unit imported by a scanned source once per configuration and
+# importing target, and pass it to every source of that target which imports it.
+function(_maud_header_units)
+  get_property(header_units GLOBAL PROPERTY _MAUD_HEADER_UNITS)
+  if(NOT header_units)
+    return()
+  endif()
+  if(NOT CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+    message(FATAL_ERROR "Header units are currently only supported with Clang")
+  endif()
+
+  set(pcms)
+  foreach(source_file ${_MAUD_CXX_SCANNED_SOURCES})
+    get_source_file_property(imported "${source_file}" MAUD_HEADER_UNITS)
+    if(NOT imported)
+      continue()
+    endif()
+    get_source_file_property(target "${source_file}" MAUD_TARGET)
+    if(NOT target)
+      set(target "")
+    endif()
+    foreach(header_unit ${imported})
+      string(MD5 key "${target} ${header_unit}")
+      if(NOT DEFINED pcm_${key})
+        _maud_add_header_unit("${target}" "${header_unit}" pcm_${key})
+        list(APPEND pcms "${pcm_${key}}")
+      endif()
+      set(pcm "${pcm_${key}}")
+      set_property(
+        SOURCE "${source_file}"
+        APPEND PROPERTY COMPILE_OPTIONS "-fmodule-file=${pcm}"
+      )
+      set_property(SOURCE "${source_file}" APPEND PROPERTY OBJECT_DEPENDS "${pcm}")
+    endforeach()
+  endforeach()
+  add_custom_target(_maud_header_units DEPENDS ${pcms})
+endfunction()
+
+
+# A header unit can only be imported by translation units compiled with compatible
+# options, so it is compiled with the same standard, extensions, flags, definitions,
+# and include directories as the target which imports it. (Sources which aren't
+# attached to a target get the directory's definitions and include directories.)
+function(_maud_add_header_unit target header_unit out_var)
+  _maud_cxx_standard_option(std)
+  _maud_configuration_types(configs)
+  set(flags "")
+  foreach(config ${configs})
+    string(TOUPPER "${config}" CONFIG)
+    separate_arguments(
+      config_flags NATIVE_COMMAND
+      "${CMAKE_CXX_FLAGS} ${CMAKE_CXX_FLAGS_${CONFIG}}"
+    )
+    list(JOIN config_flags "$<SEMICOLON>" config_flags)
+    list(APPEND flags "$<$<CONFIG:${config}>:${config_flags}>")
+  endforeach()
+
+  if(target)
+    set(definitions "$<TARGET_PROPERTY:${target},COMPILE_DEFINITIONS>")
+    set(dirs "$<TARGET_PROPERTY:${target},INCLUDE_DIRECTORIES>")
+    set(dir "${MAUD_DIR}/header_units/$<CONFIG>/${target}")
+    set(comment "Building header unit ${header_unit} for ${target}")
+  else()
+    get_directory_property(definitions COMPILE_DEFINITIONS)
+    get_directory_property(dirs INCLUDE_DIRECTORIES)
+    set(dir "${MAUD_DIR}/header_units/$<CONFIG>")
+    set(comment "Building header unit ${header_unit}")
+  endif()
+  set(definitions "$<$<BOOL:${definitions}>:-D$<JOIN:${definitions},$<SEMICOLON>-D>>")
+  set(
+    dirs
+    "$<$<BOOL:${dirs}>:${CMAKE_INCLUDE_FLAG_CXX}$<JOIN:${dirs},$<SEMICOLON>${CMAKE_INCLUDE_FLAG_CXX}>>"
+  )
+
+  if(header_unit MATCHES "^<(.*)>$")
+    set(kind system)
+  else()
+    string(REGEX MATCH "^\"(.*)\"$" _ "${header_unit}")
+    set(kind user)
+  endif()
+  set(name "${CMAKE_MATCH_1}")
+  set(pcm "${dir}/${kind}/${name}.pcm")
+
+  add_custom_command(
+    OUTPUT "${pcm}"
+    COMMAND
+    "${CMAKE_CXX_COMPILER}" ${std} ${flags} "${definitions}" "${dirs}"
+    -fmodule-header=${kind} -xc++-header "${name}"
+    -MD -MF "${pcm}.d"
+    -o "${pcm}"
+    DEPFILE "${pcm}.d"
+    COMMENT "${comment}"
+    COMMAND_EXPAND_LISTS
+    VERBATIM
+  )
+  set(${out_var} "${pcm}" PARENT_SCOPE)
+endfunction()
+
+
+# The option which selects the standard (and extensions) targets are compiled with
+function(_maud_cxx_standard_option out_var)
+  if(DEFINED CMAKE_CXX_EXTENSIONS)
+    set(extensions ${CMAKE_CXX_EXTENSIONS})
+  else()
+    set(extensions ${CMAKE_CXX_EXTENSIONS_DEFAULT})
+  endif()
+  if(extensions)
+    set(option "${CMAKE_CXX${CMAKE_CXX_STANDARD}_EXTENSION_COMPILE_OPTION}")
+  else()
+    set(option "${CMAKE_CXX${CMAKE_CXX_STANDARD}_STANDARD_COMPILE_OPTION}")
+  endif()
+  set(${out_var} "${option}" PARENT_SCOPE)
 endfunction()
 
 
@@ -313,7 +726,7 @@ function(_maud_setup_clang_format)
   if(CLANG_FORMAT_COMMAND)
     glob(formatted_files CONFIGURE_DEPENDS EXCLUDE_RENDERED ${patterns})
     list(JOIN formatted_files "\n" formatted_files)
-    file(WRITE "${MAUD_DIR}/formatted_files.list" "${formatted_files}\n")
+    _maud_write_if_different("${MAUD_DIR}/formatted_files.list" "${formatted_files}\n")
     add_test(
       NAME check.clang-formatted
       COMMAND "${CLANG_FORMAT_COMMAND}"
@@ -357,16 +770,31 @@ function(_maud_scan source_file)
     set(command sh "${ddi}.scan.sh")
   endif()
   execute_process(COMMAND ${command} COMMAND_ERROR_IS_FATAL ANY)
+  set(ddi_path "${ddi}")
 
   # ... and read back the ddi
   file(READ "${ddi}" ddi)
+  _maud_ddi_requires("${ddi}" imports header_units)
+  message(VERBOSE "  imports ${imports}")
+  if(header_units)
+    message(VERBOSE "  header units ${header_units}")
+    set_property(GLOBAL APPEND PROPERTY _MAUD_HEADER_UNITS ${header_units})
+  endif()
 
-  # collect all imports
-  json_list(imports ERROR_VARIABLE error GET "${ddi}" rules 0 requires [] logical-name)
-  if(NOT imports)
-    set(imports)
+  # maud_scan also lists the includes before the end of the interface block
+  set(includes)
+  string(JSON includes_count ERROR_VARIABLE error LENGTH "${ddi}" rules 0 _maud_includes)
+  if(error)
+    set(includes_count 0)
   endif()
-  message(VERBOSE "  imports ${imports}")
+  math(EXPR last_include "${includes_count} - 1")
+  foreach(i RANGE ${last_include})
+    if(includes_count EQUAL 0)
+      break()
+    endif()
+    string(JSON include GET "${ddi}" rules 0 _maud_includes ${i})
+    list(APPEND includes "${include}")
+  endforeach()
 
   string(JSON module ERROR_VARIABLE error GET "${ddi}" rules 0 _maud_module-name)
   if(NOT error)
@@ -406,6 +834,8 @@ function(_maud_scan source_file)
     ${source_file}
     PROPERTIES
     MAUD_IMPORTS "${imports}"
+    MAUD_HEADER_UNITS "${header_units}"
+    MAUD_INCLUDES "${includes}"
     MAUD_TYPE "${type}"
     MAUD_MODULE "${module}"
     MAUD_PARTITION "${partition}"
@@ -453,7 +883,39 @@ function(_maud_scan source_file)
     message(VERBOSE "  not automatically associated with any target")
     return()
   endif()
+
+  _maud_scan_flags(${target_name} "${source_file}" flags)
+  set(quoted_flags "")
+  foreach(flag ${flags})
+    if(flag MATCHES "[ \"\\]")
+      string(REGEX REPLACE "([\"\\])" "\\\\\\1" flag "${flag}")
+      set(flag "\"${flag}\"")
+    endif()
+    string(APPEND quoted_flags "${flag}\n")
+  endforeach()
+  file(READ "${ddi_path}.flags" scanned_flags)
+  get_source_file_property(unevaluated "${source_file}" _MAUD_UNEVALUATED_FLAGS)
+  if(NOT quoted_flags STREQUAL scanned_flags OR unevaluated)
+    message(VERBOSE "  rescanning with target flags")
+    file(WRITE "${ddi_path}.flags" "${quoted_flags}")
+    _maud_write_scan_script("${source_file}")
+    execute_process(COMMAND ${command} COMMAND_ERROR_IS_FATAL ANY)
+    file(READ "${ddi_path}" ddi)
+    _maud_ddi_requires("${ddi}" imports header_units)
+    message(VERBOSE "  imports ${imports}")
+    set_source_files_properties(
+      ${source_file}
+      PROPERTIES
+      MAUD_IMPORTS "${imports}"
+      MAUD_HEADER_UNITS "${header_units}"
+    )
+    if(header_units)
+      set_property(GLOBAL APPEND PROPERTY _MAUD_HEADER_UNITS ${header_units})
+    endif()
+  endif()
+
   message(VERBOSE "  attaching to ${target_name}")
+  set_source_files_properties(${source_file} PROPERTIES MAUD_TARGET ${target_name})
 
   set_property(TARGET ${target_name} APPEND PROPERTY MAUD_IMPORTS "${imports}")
   set_target_properties(${target_name} PROPERTIES MAUD_SCANNED ON)
@@ -507,6 +969,17 @@ endfunction()
 
 
 function(_maud_add_test source_file module partition out_target_name)
+  if(NOT TARGET _maud_test_)
+    _maud_builtin_module_library(_maud_test_ "${_MAUD_SELF_DIR}/test_.cxx")
+    target_compile_options(
+      _maud_test_
+      PUBLIC
+      "${_MAUD_INCLUDE} ${_MAUD_SELF_DIR}/test_.hxx"
+    )
+    # gtest_main is only linked if there is no test_:main (see _maud_finalize_targets)
+    target_link_libraries(_maud_test_ PUBLIC GTest::gtest)
+  endif()
+
   if(partition STREQUAL "main")
     if(_MAUD_TEST_MAIN)
       message(
@@ -519,6 +992,8 @@ function(_maud_add_test source_file module partition out_target_name)
       )
     endif()
     set(_MAUD_TEST_MAIN "${source_file}" CACHE INTERNAL "" FORCE)
+    # test_:main is compiled once, alongside test_
+    set(${out_target_name} _maud_test_ PARENT_SCOPE)
     return()
   endif()
 
@@ -534,19 +1009,34 @@ function(_maud_add_test source_file module partition out_target_name)
     add_executable(test_.${name})
   endif()
   add_test(NAME test_.${name} COMMAND $<TARGET_FILE:test_.${name}> --gtest_brief=1)
-  target_sources(
+  target_link_libraries(test_.${name} PRIVATE _maud_test_)
+  set_target_properties(
     test_.${name}
-    PRIVATE
+    PROPERTIES
+    MAUD_INTERFACE "${_MAUD_SELF_DIR}/test_.cxx"
+  )
+endfunction()
+
+
+# Modules provided by Maud itself are each compiled once into an object library
+# which every consumer links, rather than once for each consuming target.
+function(_maud_builtin_module_library target source)
+  if(TARGET ${target})
+    return()
+  endif()
+  add_library(${target} OBJECT EXCLUDE_FROM_ALL)
+  target_sources(
+    ${target}
+    PUBLIC
     FILE_SET module_providers
     TYPE CXX_MODULES
     ${_MAUD_BASE_DIRS}
-    FILES "${_MAUD_SELF_DIR}/test_.cxx"
+    FILES "${source}"
   )
-  set_target_properties(
-    test_.${name}
-    PROPERTIES
-    MAUD_INTERFACE "${_MAUD_SELF_DIR}/test_.cxx"
-    COMPILE_OPTIONS "${_MAUD_INCLUDE} ${_MAUD_SELF_DIR}/test_.hxx"
+  target_compile_features(
+    ${target}
+    PUBLIC
+    cxx_std_${CMAKE_CXX_STANDARD}
   )
 endfunction()
 
@@ -571,8 +1061,28 @@ function(_maud_rescan source_file out_var)
   else()
     set(command sh "${ddi}.scan.sh" .new)
   endif()
+
+  # Sources which import header units need a different scan script
+  _maud_header_unit_imports("${source_file}" header_units)
+  if(header_units)
+    list(GET command -2 script)
+    file(READ "${script}" script)
+    if(NOT script MATCHES "--take-undecided")
+      set(${out_var} "HEADER UNITS ${source_file}" PARENT_SCOPE)
+      return()
+    endif()
+  endif()
   execute_process(COMMAND ${command} COMMAND_ERROR_IS_FATAL ANY)
 
+  if(_MAUD_OPTION_MACROS AND EXISTS "${ddi}.options")
+    file(READ "${ddi}.options" old_options)
+    _maud_option_references(new_options "${source_file}")
+    if(NOT old_options STREQUAL new_options)
+      set(${out_var} "OPTIONS BEFORE=${old_options}\nAFTER=${new_options}" PARENT_SCOPE)
+      return()
+    endif()
+  endif()
+
   file(READ "${ddi}" old_ddi)
   file(READ "${ddi}.new" new_ddi)
   string(COMPARE EQUAL "${old_ddi}" "${new_ddi}" equal)
@@ -585,16 +1095,105 @@ function(_maud_rescan source_file out_var)
 endfunction()
 
 
+# find_package() searches the whole prefix path for the config of each installed
+# module which is imported, on every fresh configuration. To skip that search, the
+# directory in which each config was found is recorded in an index which outlives
+# the cache. The index is discarded if anything which find_package() would consult
+# has changed since: the prefix path, the find root path, an imported module's
+# <PackageName>_ROOT, or the mtime of any prefix or of the directories below it in
+# which installed configs are found. An indexed directory which no longer holds
+# the config is also ignored.
+function(_maud_import_index_stamp imports out_var)
+  set(stamp "CMAKE_FIND_ROOT_PATH=${CMAKE_FIND_ROOT_PATH}")
+  foreach(import ${imports})
+    string(TOUPPER "${import}.maud_ROOT" IMPORT_ROOT)
+    foreach(root "${import}.maud_ROOT" ${IMPORT_ROOT})
+      list(APPEND stamp "${root}=${${root}}" "ENV{${root}}=$ENV{${root}}")
+    endforeach()
+  endforeach()
+
+  cmake_path(CONVERT "$ENV{CMAKE_PREFIX_PATH}" TO_CMAKE_PATH_LIST env_prefixes)
+  set(search_prefixes ${CMAKE_PREFIX_PATH} ${env_prefixes} ${CMAKE_SYSTEM_PREFIX_PATH})
+  set(prefixes ${search_prefixes})
+  foreach(root ${CMAKE_FIND_ROOT_PATH})
+    foreach(prefix ${search_prefixes})
+      list(APPEND prefixes "${root}${prefix}")
+    endforeach()
+  endforeach()
+
+  set(dirs "")
+  foreach(prefix ${prefixes})
+    list(
+      APPEND dirs
+      "${prefix}"
+      "${prefix}/${CMAKE_INSTALL_LIBDIR}/cmake"
+      "${prefix}/lib/cmake"
+      "${prefix}/lib64/cmake"
+      "${prefix}/share/cmake"
+    )
+    if(CMAKE_LIBRARY_ARCHITECTURE)
+      list(APPEND dirs "${prefix}/lib/${CMAKE_LIBRARY_ARCHITECTURE}/cmake")
+    endif()
+  endforeach()
+  list(REMOVE_DUPLICATES dirs)
+  foreach(dir ${dirs})
+    file(TIMESTAMP "${dir}" mtime "%s" UTC)
+    list(APPEND stamp "${dir}=${mtime}")
+  endforeach()
+  set(${out_var} "${stamp}" PARENT_SCOPE)
+endfunction()
+
+
+function(_maud_write_import_index imports)
+  _maud_import_index_stamp("${imports}" stamp)
+  set(index "# Where the configs of imported modules were found\n")
+  string(APPEND index "set(_maud_import_index_imports [==[${imports}]==])\n")
+  string(APPEND index "set(_maud_import_index_stamp [==[${stamp}]==])\n")
+  foreach(import ${imports})
+    string(APPEND index "set(_maud_import_dir_${import} [==[${${import}.maud_DIR}]==])\n")
+  endforeach()
+  _maud_write_if_different("${MAUD_DIR}/import_index.cmake" "${index}")
+endfunction()
+
+
 function(_maud_finalize_targets)
   include(GNUInstallDirs)
   message(STATUS "TARGETS:")
+
+  set(_maud_import_index_imports "")
+  set(_maud_import_index_stamp "")
+  if(EXISTS "${MAUD_DIR}/import_index.cmake")
+    include("${MAUD_DIR}/import_index.cmake")
+  endif()
+  _maud_import_index_stamp("${_maud_import_index_imports}" import_index_stamp)
+  if(NOT _maud_import_index_stamp STREQUAL import_index_stamp)
+    message(VERBOSE "Import index is stale")
+    set(import_index_valid FALSE)
+  else()
+    set(import_index_valid TRUE)
+  endif()
+  set(found_imports "")
   get_property(
     targets
     DIRECTORY .
     PROPERTY BUILDSYSTEM_TARGETS
   )
+
+  if(TARGET _maud_test_ AND NOT _MAUD_TEST_MAIN)
+    target_sources(
+      _maud_test_
+      PUBLIC
+      FILE_SET module_providers
+      TYPE CXX_MODULES
+      ${_MAUD_BASE_DIRS}
+      FILES "${_MAUD_SELF_DIR}/test_main_.cxx"
+    )
+    target_link_libraries(_maud_test_ PUBLIC GTest::gtest_main)
+  endif()
+
   foreach(target ${targets})
-    if(target MATCHES "^_maud")
+    # _maud_test_ may contain a user's test_:main, whose imports must be linked
+    if(target MATCHES "^_maud" AND NOT target STREQUAL "_maud_test_")
       continue()
     endif()
 
@@ -603,7 +1202,12 @@ function(_maud_finalize_targets)
       continue()
     endif()
 
-    message(STATUS "${target}: ${target_type}")
+    if(target STREQUAL "_maud_test_")
+      # Maud's own targets aren't listed
+      message(VERBOSE "${target}: ${target_type}")
+    else()
+      message(STATUS "${target}: ${target_type}")
+    endif()
     get_target_property(scanned ${target} MAUD_SCANNED)
     if(NOT scanned)
       message(VERBOSE "  NOT A MAUD TARGET")
@@ -618,41 +1222,75 @@ function(_maud_finalize_targets)
 
     # Link targets to imported modules
     list(FILTER imports EXCLUDE REGEX ":")
+    if("std" IN_LIST imports OR "std.compat" IN_LIST imports)
+      _maud_import_std(${target})
+    endif()
     foreach(import ${imports})
-      if(import STREQUAL "executable" OR import STREQUAL "test_")
+      if(import MATCHES "^(executable|test_|std|std[.]compat)$")
         continue()
       endif()
       if(NOT TARGET ${import})
+        if(
+          import_index_valid
+          AND NOT ${import}.maud_DIR
+          AND EXISTS "${_maud_import_dir_${import}}/${import}.maud-config.cmake"
+        )
+          # find_package() looks in <PackageName>_DIR before searching
+          message(VERBOSE "  ${import} from the import index: ${_maud_import_dir_${import}}")
+          set(${import}.maud_DIR "${_maud_import_dir_${import}}")
+        endif()
         find_package("${import}.maud" REQUIRED CONFIG)
+        list(APPEND found_imports ${import})
+        _maud_use_prebuilt_bmis(${import})
       endif()
       if(import STREQUAL target) # for example a partition might import the primary
         continue()
       endif()
       target_link_libraries(${target} PRIVATE ${import})
+
+      # CMake doesn't know about BMIs found with -fprebuilt-module-path
+      get_target_property(bmis ${import} MAUD_PREBUILT_BMIS)
+      if(bmis)
+        get_target_property(sources ${target} SOURCES)
+        foreach(source ${sources})
+          get_source_file_property(source_imports "${source}" MAUD_IMPORTS)
+          if(import IN_LIST source_imports)
+            set_property(SOURCE "${source}" APPEND PROPERTY OBJECT_DEPENDS ${bmis})
+          endif()
+        endforeach()
+      endif()
     endforeach()
 
+    if(target STREQUAL "_maud_test_")
+      # Nothing else is needed for test_ (or for test_:main) from here on
+      continue()
+    endif()
+
     get_target_property(interface ${target} MAUD_INTERFACE)
-    if(NOT interface)
-      if(target_type STREQUAL "EXECUTABLE")
-        set(interface "${_MAUD_SELF_DIR}/executable.cxx")
-        set(source_access PRIVATE)
-      else()
-        get_target_property(src ${target} MAUD_INTERFACE_PARTITIONS)
-        set(interface "${MAUD_DIR}/injected/${target}.cxx")
-        list(TRANSFORM src PREPEND "\nexport import :")
-        list(PREPEND src "export module ${target}")
-        file(WRITE "${MAUD_DIR}/injected/${target}.cxx" "${src};\n")
-        set_source_files_properties(
-          "${MAUD_DIR}/injected/${target}.cxx"
-          PROPERTIES
-          MAUD_TYPE INTERFACE
-        )
-        set(source_access PUBLIC)
-        message(VERBOSE "  No primary interface supplied, injecting ${interface}")
-      endif()
+    if(NOT interface AND target_type STREQUAL "EXECUTABLE")
+      _maud_builtin_module_library(_maud_executable "${_MAUD_SELF_DIR}/executable.cxx")
+      target_link_libraries(${target} PRIVATE _maud_executable)
+    elseif(NOT interface)
+      get_target_property(src ${target} MAUD_INTERFACE_PARTITIONS)
+      set(interface "${MAUD_DIR}/injected/${target}.cxx")
+      list(TRANSFORM src PREPEND "\nexport import :")
+      list(PREPEND src "export module ${target}")
+      _maud_write_if_different("${MAUD_DIR}/injected/${target}.cxx" "${src};\n")
+      set(partition_imports "${src}")
+      list(FILTER partition_imports INCLUDE REGEX "^\nexport import :")
+      list(TRANSFORM partition_imports REPLACE "^\nexport import " "${target}")
+      set_source_files_properties(
+        "${MAUD_DIR}/injected/${target}.cxx"
+        PROPERTIES
+        MAUD_TYPE INTERFACE
+        MAUD_MODULE "${target}"
+        MAUD_PARTITION ""
+        MAUD_IMPORTS "${partition_imports}"
+      )
+      message(VERBOSE "  No primary interface supplied, injecting ${interface}")
       target_sources(
         ${target}
-        ${source_access}
+        PUBLIC
         FILE_SET module_providers
         TYPE CXX_MODULES
         ${_MAUD_BASE_DIRS}
@@ -660,54 +1298,589 @@ function(_maud_finalize_targets)
       )
     endif()
     print_target_sources(${target})
+    _maud_compile_launcher(${target})
+    _maud_automatic_pch(${target})
+    if(TARGET _maud_header_units)
+      # Header units must exist before sources which import them are scanned
+      add_dependencies(${target} _maud_header_units)
+    endif()
 
     if(TEST ${target})
       if(NOT COMMAND "maud_add_test")
-        target_link_libraries(${target} PRIVATE GTest::gtest_main)
+        # test_ and test_:main are linked from _maud_test_
+        continue()
       endif()
       if(_MAUD_TEST_MAIN)
         set(test_main "${_MAUD_TEST_MAIN}")
       else()
-        set(test_main "${_MAUD_SELF_DIR}/test_main_.cxx")
+        set(test_main "${_MAUD_SELF_DIR}/test_main_.cxx")
+      endif()
+      target_sources(
+        ${target}
+        PRIVATE
+        FILE_SET module_providers
+        TYPE CXX_MODULES
+        BASE_DIRS ${_MAUD_BASE_DIRS}
+        FILES "${test_main}"
+      )
+      continue()
+    endif()
+
+    set(is_exe $<STREQUAL:$<TARGET_PROPERTY:${target},TYPE>,EXECUTABLE>)
+    set(
+      install_dir
+      "$<IF:${is_exe},${CMAKE_INSTALL_BINDIR},${CMAKE_INSTALL_LIBDIR}>"
+    )
+    if(target MATCHES _$)
+      set(junk_prefix "${MAUD_DIR}/junk/")
+    else()
+      set(junk_prefix "")
+    endif()
+
+    install(
+      TARGETS ${target}
+      EXPORT ${target}
+      DESTINATION "${junk_prefix}${install_dir}"
+      CXX_MODULES_BMI
+      DESTINATION "${junk_prefix}${install_dir}/bmi/${CMAKE_CXX_COMPILER_ID}/$<CONFIG>"
+      FILE_SET module_providers
+      DESTINATION "${junk_prefix}${install_dir}/module_interface/${target}"
+    )
+    install(
+      EXPORT ${target}
+      DESTINATION "${junk_prefix}${CMAKE_INSTALL_LIBDIR}/cmake"
+      FILE ${target}.maud-config.cmake
+      # TODO support injecting more cmake into maud-config.cmake
+    )
+    get_target_property(type ${target} TYPE)
+    if(NOT junk_prefix AND NOT type STREQUAL "EXECUTABLE")
+      _maud_install_bmi_toolchain(${target})
+    endif()
+  endforeach()
+  _maud_write_import_index("${found_imports}")
+endfunction()
+
+
+# Compile a target's module units with maud_compile, which leaves each BMI untouched
+# when its content is unchanged. Since maud_inject_regenerate marks the compile rules
+# with restat, ninja then skips recompiling importers of that BMI. Reduced BMIs omit
+# non-exported function bodies and the like, so more edits leave them unchanged.
+#
+# With MAUD_COMPILE_CACHE, every source is compiled with maud_compile, which reuses
+# objects and BMIs from MAUD_COMPILE_CACHE_DIR when their inputs are identical.
+function(_maud_compile_launcher target)
+  if(NOT CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+    return()
+  endif()
+
+  get_target_property(providers ${target} CXX_MODULE_SET_module_providers)
+  if(providers AND MAUD_REDUCED_BMI AND CMAKE_GENERATOR MATCHES "Ninja")
+    if(CMAKE_CXX_COMPILER_VERSION VERSION_GREATER_EQUAL 19)
+      set(reduced_bmi -fmodules-reduced-bmi)
+    elseif(CMAKE_CXX_COMPILER_VERSION VERSION_GREATER_EQUAL 18)
+      set(reduced_bmi -fexperimental-modules-reduced-bmi)
+    endif()
+    if(reduced_bmi)
+      # Input files' timestamps would otherwise make every BMI distinct.
+      set_property(
+        SOURCE ${providers}
+        APPEND PROPERTY COMPILE_OPTIONS
+        ${reduced_bmi} "SHELL:-Xclang -fno-pch-timestamp"
+      )
+    endif()
+  endif()
+
+  if(NOT MAUD_COMPILE_CACHE AND (NOT providers OR NOT CMAKE_GENERATOR MATCHES "Ninja"))
+    return()
+  endif()
+  if(TARGET maud_compile)
+    # A launcher can't be built by the build which uses it
+    return()
+  endif()
+  find_program(_MAUD_COMPILE maud_compile)
+  mark_as_advanced(_MAUD_COMPILE)
+  if(NOT _MAUD_COMPILE)
+    return()
+  endif()
+
+  get_target_property(launcher ${target} CXX_COMPILER_LAUNCHER)
+  if(NOT launcher)
+    set(launcher "")
+  endif()
+  if(NOT _MAUD_COMPILE IN_LIST launcher)
+    if(MAUD_COMPILE_CACHE)
+      list(PREPEND launcher --cache "${MAUD_COMPILE_CACHE_DIR}")
+    endif()
+    list(PREPEND launcher "${_MAUD_COMPILE}")
+    set_target_properties(${target} PROPERTIES CXX_COMPILER_LAUNCHER "${launcher}")
+  endif()
+endfunction()
+
+
+# Write the module graph of every scanned target to module_graph.json, and add a
+# maud_build_report target which joins it with .ninja_log. Each source records
+# the object file CMake will compile it to so that the two can be matched up.
+function(_maud_module_graph)
+  get_property(
+    targets
+    DIRECTORY .
+    PROPERTY BUILDSYSTEM_TARGETS
+  )
+
+  set(units "")
+  set(comma "")
+  foreach(target ${targets})
+    get_target_property(scanned ${target} MAUD_SCANNED)
+    if(NOT scanned)
+      continue()
+    endif()
+
+    get_target_property(sources ${target} SOURCES)
+    get_target_property(providers ${target} CXX_MODULE_SET_module_providers)
+    list(APPEND sources ${providers})
+    list(REMOVE_DUPLICATES sources)
+    foreach(source ${sources})
+      get_source_file_property(type "${source}" MAUD_TYPE)
+      if(type STREQUAL "NOTFOUND")
+        continue()
+      endif()
+      get_source_file_property(module "${source}" MAUD_MODULE)
+      get_source_file_property(partition "${source}" MAUD_PARTITION)
+      get_source_file_property(imports "${source}" MAUD_IMPORTS)
+      foreach(property module partition imports)
+        if(${property} STREQUAL "NOTFOUND")
+          set(${property} "")
+        endif()
+      endforeach()
+
+      # Like CMake, prefer paths relative to the binary directory.
+      cmake_path(ABSOLUTE_PATH source NORMALIZE OUTPUT_VARIABLE object)
+      cmake_path(IS_PREFIX CMAKE_BINARY_DIR "${object}" NORMALIZE in_binary_dir)
+      if(in_binary_dir)
+        cmake_path(RELATIVE_PATH object BASE_DIRECTORY "${CMAKE_BINARY_DIR}")
+      else()
+        cmake_path(RELATIVE_PATH object BASE_DIRECTORY "${CMAKE_SOURCE_DIR}")
+      endif()
+      string(APPEND object "${CMAKE_CXX_OUTPUT_EXTENSION}")
+
+      set(unit "")
+      foreach(property source target type module partition object)
+        string_escape("${${property}}" value)
+        string(APPEND unit "\"${property}\": \"${value}\", ")
+      endforeach()
+      set(imports_json "")
+      foreach(import ${imports})
+        string_escape("${import}" import)
+        list(APPEND imports_json "\"${import}\"")
+      endforeach()
+      list(JOIN imports_json ", " imports_json)
+      set(unit "\n  {${unit}\"imports\": [${imports_json}]}")
+      string(APPEND units "${comma}${unit}")
+      set(comma ",")
+    endforeach()
+  endforeach()
+
+  _maud_write_if_different("${MAUD_DIR}/module_graph.json" "[${units}\n]\n")
+
+  if(NOT CMAKE_GENERATOR MATCHES "Ninja")
+    return()
+  endif()
+  if(TARGET maud_report)
+    set(report "$<TARGET_FILE:maud_report>")
+  else()
+    find_program(_MAUD_REPORT maud_report)
+    mark_as_advanced(_MAUD_REPORT)
+    if(NOT _MAUD_REPORT)
+      return()
+    endif()
+    set(report "${_MAUD_REPORT}")
+  endif()
+  add_custom_target(
+    maud_build_report
+    COMMAND
+    "${report}"
+    "${MAUD_DIR}/module_graph.json"
+    "${CMAKE_BINARY_DIR}/.ninja_log"
+    "${CMAKE_BINARY_DIR}/build_report"
+    COMMENT "Writing build_report/report.json and build_report/module_graph.dot"
+    VERBATIM
+  )
+endfunction()
+
+
+# The parts of the toolchain which must be identical for a BMI to be reusable.
+function(_maud_bmi_toolchain config out_var)
+  string(TOUPPER "${config}" CONFIG)
+  set(
+    ${out_var}
+    "${CMAKE_CXX_COMPILER_ID} ${CMAKE_CXX_COMPILER_VERSION}"
+    "target=${CMAKE_CXX_COMPILER_TARGET}"
+    "standard=${CMAKE_CXX_STANDARD} extensions=${CMAKE_CXX_EXTENSIONS}"
+    "flags=${CMAKE_CXX_FLAGS} ${CMAKE_CXX_FLAGS_${CONFIG}}"
+    PARENT_SCOPE
+  )
+endfunction()
+
+
+function(_maud_configuration_types out_var)
+  if(CMAKE_CONFIGURATION_TYPES)
+    set(${out_var} "${CMAKE_CONFIGURATION_TYPES}" PARENT_SCOPE)
+  else()
+    set(${out_var} "${CMAKE_BUILD_TYPE}" PARENT_SCOPE)
+  endif()
+endfunction()
+
+
+function(_maud_generate_bmi_toolchain target config condition imports source_options)
+  _maud_bmi_toolchain("${config}" toolchain)
+  file(
+    GENERATE
+    OUTPUT "${MAUD_DIR}/bmi_toolchain/config-${config}/${target}.maud-toolchain.cmake"
+    CONTENT "# The toolchain which compiled the BMIs of ${target} in this directory
+set(_maud_bmi_config [==[${config}]==])
+set(_maud_bmi_toolchain [==[${toolchain}]==])
+set(_maud_bmi_definitions [==[$<TARGET_PROPERTY:${target},COMPILE_DEFINITIONS>]==])
+set(_maud_bmi_options [==[$<TARGET_PROPERTY:${target},COMPILE_OPTIONS>]==])
+set(_maud_bmi_source_options [==[${source_options}]==])
+set(_maud_bmi_imports [==[${imports}]==])
+"
+    CONDITION "${condition}"
+  )
+endfunction()
+
+
+# Install a record of the toolchain which compiled the installed BMIs of a target
+# alongside them, for _maud_use_prebuilt_bmis in downstream projects. Each
+# configuration's BMIs and record are installed to their own directory. Besides
+# the global toolchain, the record holds the target's own compile definitions and
+# options, the compile options of its interface units, and the modules it imports
+# (whose BMIs must be reusable too).
+#
+# Interface units' own options aren't exported, so an importer which rebuilt them
+# wouldn't use them. Those which Maud adds are left out of the record: the option
+# headers only define macros (which a BMI doesn't export) and reduced BMIs are
+# imported just like full ones.
+function(_maud_install_bmi_toolchain target)
+  get_target_property(imports ${target} MAUD_IMPORTS)
+  if(NOT imports)
+    set(imports "")
+  endif()
+  list(FILTER imports EXCLUDE REGEX ":|^(executable|test_|std|std[.]compat)$")
+  list(REMOVE_ITEM imports ${target})
+  list(REMOVE_DUPLICATES imports)
+
+  set(source_options "")
+  get_target_property(providers ${target} CXX_MODULE_SET_module_providers)
+  foreach(provider ${providers})
+    get_source_file_property(options "${provider}" COMPILE_OPTIONS)
+    foreach(option ${options})
+      string(FIND "${option}" "${_MAUD_INCLUDE}" include)
+      if(include EQUAL 0 OR option MATCHES "modules-reduced-bmi|-fno-pch-timestamp")
+        continue()
+      endif()
+      list(APPEND source_options "${option}")
+    endforeach()
+  endforeach()
+
+  _maud_configuration_types(configs)
+  if(configs)
+    foreach(config ${configs})
+      _maud_generate_bmi_toolchain(
+        ${target} "${config}" "$<CONFIG:${config}>" "${imports}" "${source_options}"
+      )
+    endforeach()
+  else()
+    _maud_generate_bmi_toolchain(${target} "" 1 "${imports}" "${source_options}")
+  endif()
+  install(
+    FILES "${MAUD_DIR}/bmi_toolchain/config-$<CONFIG>/${target}.maud-toolchain.cmake"
+    DESTINATION "${CMAKE_INSTALL_LIBDIR}/bmi/${CMAKE_CXX_COMPILER_ID}/$<CONFIG>"
+  )
+endfunction()
+
+
+# Headers which most of a target's non-module translation units include are
+# precompiled once for the target instead of being parsed by each unit. Only <>
+# includes are considered, since "" includes are looked up relative to the
+# including file. Module units can't use a precompiled header (it would precede
+# their module declaration), so they skip it.
+function(_maud_automatic_pch target)
+  if(NOT MAUD_AUTOMATIC_PCH)
+    return()
+  endif()
+  if(NOT MAUD_AUTOMATIC_PCH_THRESHOLD MATCHES "^[0-9]+$")
+    message(
+      FATAL_ERROR
+      "MAUD_AUTOMATIC_PCH_THRESHOLD must be a percentage, but was '${MAUD_AUTOMATIC_PCH_THRESHOLD}'"
+    )
+  endif()
+
+  get_target_property(sources ${target} SOURCES)
+  get_target_property(providers ${target} CXX_MODULE_SET_module_providers)
+  list(APPEND sources ${providers})
+  list(REMOVE_DUPLICATES sources)
+  set(units "")
+  set(module_units "")
+  set(all_includes "")
+  foreach(source ${sources})
+    get_source_file_property(module "${source}" MAUD_MODULE)
+    if(module STREQUAL "NOTFOUND")
+      continue()
+    elseif(module)
+      list(APPEND module_units "${source}")
+      continue()
+    endif()
+    list(APPEND units "${source}")
+    get_source_file_property(includes "${source}" MAUD_INCLUDES)
+    list(FILTER includes INCLUDE REGEX "^<")
+    list(REMOVE_DUPLICATES includes)
+    list(APPEND all_includes ${includes})
+  endforeach()
+
+  list(LENGTH units unit_count)
+  if(unit_count LESS 2)
+    return()
+  endif()
+
+  # Count the units which include each header, keeping the order of first inclusion
+  set(pch "")
+  set(distinct ${all_includes})
+  list(REMOVE_DUPLICATES distinct)
+  list(LENGTH all_includes before)
+  foreach(include ${distinct})
+    list(REMOVE_ITEM all_includes "${include}")
+    list(LENGTH all_includes after)
+    math(EXPR count "${before} - ${after}")
+    set(before ${after})
+    math(EXPR excess "${count} * 100 - ${MAUD_AUTOMATIC_PCH_THRESHOLD} * ${unit_count}")
+    if(excess GREATER 0)
+      list(APPEND pch "${include}")
+    endif()
+  endforeach()
+  if(NOT pch)
+    return()
+  endif()
+
+  message(VERBOSE "  precompiling ${pch}")
+  target_precompile_headers(${target} PRIVATE ${pch})
+  if(module_units)
+    set_source_files_properties(
+      ${module_units}
+      PROPERTIES
+      SKIP_PRECOMPILE_HEADERS ON
+    )
+  endif()
+endfunction()
+
+
+# std and std.compat are provided by CMake rather than by a package: targets with
+# CXX_MODULE_STD share a std module which is built once per configuration.
+function(_maud_import_std target)
+  if(CMAKE_CXX_STANDARD IN_LIST CMAKE_CXX_COMPILER_IMPORT_STD)
+    message(VERBOSE "  std from CMake")
+    set_target_properties(${target} PROPERTIES CXX_MODULE_STD ON)
+    return()
+  endif()
+
+  if(CMAKE_VERSION VERSION_LESS 3.30)
+    set(reason "CMake ${CMAKE_VERSION} is too old; import std requires CMake 3.30 or later.")
+  elseif(NOT CMAKE_CXX_COMPILER_IMPORT_STD)
+    set(
+      reason
+      "CMake can't build the std module with ${CMAKE_CXX_COMPILER_ID} ${CMAKE_CXX_COMPILER_VERSION}.
+        Check that the compiler and its standard library ship the std module, and
+        that CMAKE_EXPERIMENTAL_CXX_IMPORT_STD is set before project() if this
+        version of CMake requires it."
+    )
+  else()
+    list(JOIN CMAKE_CXX_COMPILER_IMPORT_STD ", C++" standards)
+    set(
+      reason
+      "the std module is only available for C++${standards}, but this project
+        is configured for C++${CMAKE_CXX_STANDARD}."
+    )
+  endif()
+  message(
+    FATAL_ERROR
+    "
+    ${target} imports std, but
+        ${reason}
+    "
+  )
+endfunction()
+
+
+# If the BMIs installed with an imported target for a configuration were compiled
+# by a toolchain which is identical to ours, with the definitions and options which
+# we would compile its interface with, and the BMIs of everything it imports are
+# reused too, use them rather than rebuilding its interface from source.
+#
+# Without a build type, BMIs are installed to the BMI root itself and the imported
+# target's configuration is NOCONFIG. The prebuilt BMIs (with those of its imports)
+# are listed in MAUD_PREBUILT_BMIS, so that importers can depend on them.
+function(_maud_use_prebuilt_bmis target)
+  get_target_property(checked ${target} MAUD_PREBUILT_BMIS_CHECKED)
+  if(checked)
+    return()
+  endif()
+  set_target_properties(
+    ${target}
+    PROPERTIES
+    MAUD_PREBUILT_BMIS_CHECKED ON
+    MAUD_PREBUILT_BMI_CONFIGS ""
+    MAUD_PREBUILT_BMIS ""
+  )
+  if(NOT CMAKE_CXX_COMPILER_ID STREQUAL "Clang")
+    # Other compilers can't look up BMIs which aren't in CMake's module map.
+    return()
+  endif()
+
+  # These are what an interface compiled from source would be compiled with
+  foreach(property DEFINITIONS OPTIONS)
+    get_target_property(expected_${property} ${target} IMPORTED_CXX_MODULES_COMPILE_${property})
+    if(NOT expected_${property})
+      set(expected_${property} "")
+    elseif(expected_${property} MATCHES "[$]<")
+      message(VERBOSE "  ${target} interface flags depend on generator expressions, rebuilding")
+      return()
+    endif()
+  endforeach()
+
+  cmake_path(
+    SET bmi_root NORMALIZE
+    "${${target}.maud_DIR}/../bmi/${CMAKE_CXX_COMPILER_ID}"
+  )
+  get_target_property(imported_configs ${target} IMPORTED_CONFIGURATIONS)
+  _maud_configuration_types(configs)
+  if(NOT configs)
+    set(configs NOCONFIG)
+  endif()
+  set(prebuilt "")
+  foreach(config ${configs})
+    string(TOUPPER "${config}" CONFIG)
+    if(config STREQUAL "NOCONFIG")
+      set(bmi_dir_${CONFIG} "${bmi_root}")
+    else()
+      set(bmi_dir_${CONFIG} "${bmi_root}/${config}")
+    endif()
+    set(record "${bmi_dir_${CONFIG}}/${target}.maud-toolchain.cmake")
+    if(NOT CONFIG IN_LIST imported_configs OR NOT EXISTS "${record}")
+      continue()
+    endif()
+    set(_maud_bmi_source_options "")
+    include("${record}")
+
+    _maud_bmi_toolchain("${config}" toolchain)
+    if(NOT "${toolchain};${expected_DEFINITIONS};${expected_OPTIONS}" STREQUAL
+       "${_maud_bmi_toolchain};${_maud_bmi_definitions};${_maud_bmi_options}"
+       OR _maud_bmi_source_options
+    )
+      message(
+        VERBOSE
+        "  ${target} ${config} BMIs were compiled by a different toolchain, rebuilding
+    installed: ${_maud_bmi_toolchain} ${_maud_bmi_definitions} ${_maud_bmi_options}
+               ${_maud_bmi_source_options}
+    current:   ${toolchain} ${expected_DEFINITIONS} ${expected_OPTIONS}"
+      )
+      continue()
+    endif()
+
+    # A BMI refers to the BMIs of its imports, so they must all be reused as well
+    set(imports_prebuilt ON)
+    foreach(import ${_maud_bmi_imports})
+      if(NOT TARGET ${import})
+        find_package("${import}.maud" CONFIG QUIET)
+      endif()
+      if(TARGET ${import})
+        _maud_use_prebuilt_bmis(${import})
+        get_target_property(import_configs ${import} MAUD_PREBUILT_BMI_CONFIGS)
+      else()
+        set(import_configs "")
       endif()
-      target_sources(
+      if(NOT CONFIG IN_LIST import_configs)
+        message(VERBOSE "  ${target} imports ${import} which is rebuilt for ${config}")
+        set(imports_prebuilt OFF)
+        break()
+      endif()
+    endforeach()
+    if(imports_prebuilt)
+      list(APPEND prebuilt ${CONFIG})
+      message(VERBOSE "  using prebuilt ${config} BMIs of ${target} from ${bmi_root}")
+    endif()
+  endforeach()
+  set_target_properties(${target} PROPERTIES MAUD_PREBUILT_BMI_CONFIGS "${prebuilt}")
+  if(NOT prebuilt)
+    return()
+  endif()
+
+  # Configurations which would otherwise have fallen back to an imported
+  # configuration whose BMIs are prebuilt still need to compile the interface from
+  # source, so map them to a copy of that configuration which keeps its module
+  # sources.
+  list(GET imported_configs 0 FALLBACK)
+  set(copy_config OFF)
+  foreach(config ${configs})
+    string(TOUPPER "${config}" CONFIG)
+    if(NOT CONFIG IN_LIST imported_configs AND FALLBACK IN_LIST prebuilt)
+      set_target_properties(
         ${target}
-        PRIVATE
-        FILE_SET module_providers
-        TYPE CXX_MODULES
-        BASE_DIRS ${_MAUD_BASE_DIRS}
-        FILES "${test_main}"
+        PROPERTIES
+        MAP_IMPORTED_CONFIG_${CONFIG} MAUD_FROM_SOURCE
       )
-      continue()
+      set(copy_config ON)
     endif()
-
-    set(is_exe $<STREQUAL:$<TARGET_PROPERTY:${target},TYPE>,EXECUTABLE>)
-    set(
-      install_dir
-      "$<IF:${is_exe},${CMAKE_INSTALL_BINDIR},${CMAKE_INSTALL_LIBDIR}>"
+  endforeach()
+  if(copy_config)
+    foreach(
+      property
+      IMPORTED_LOCATION IMPORTED_IMPLIB IMPORTED_SONAME IMPORTED_NO_SONAME
+      IMPORTED_OBJECTS IMPORTED_LINK_INTERFACE_LANGUAGES IMPORTED_CXX_MODULES
     )
-    if(target MATCHES _$)
-      set(junk_prefix "${MAUD_DIR}/junk/")
+      get_target_property(value ${target} ${property}_${FALLBACK})
+      if(value)
+        set_target_properties(
+          ${target}
+          PROPERTIES
+          ${property}_MAUD_FROM_SOURCE "${value}"
+        )
+      endif()
+    endforeach()
+    set_property(TARGET ${target} APPEND PROPERTY IMPORTED_CONFIGURATIONS MAUD_FROM_SOURCE)
+  endif()
+
+  # With no module sources for the configuration, CMake won't compile any BMIs.
+  # Importers find the prebuilt ones by module name instead.
+  set(bmis "")
+  foreach(config ${configs})
+    string(TOUPPER "${config}" CONFIG)
+    if(NOT CONFIG IN_LIST prebuilt)
+      continue()
+    endif()
+    set_target_properties(${target} PROPERTIES IMPORTED_CXX_MODULES_${CONFIG} "")
+    if(config STREQUAL "NOCONFIG")
+      set(condition 1)
     else()
-      set(junk_prefix "")
+      set(condition "$<CONFIG:${config}>")
     endif()
-
-    install(
-      TARGETS ${target}
-      EXPORT ${target}
-      DESTINATION "${junk_prefix}${install_dir}"
-      CXX_MODULES_BMI
-      DESTINATION "${junk_prefix}${install_dir}/bmi/${CMAKE_CXX_COMPILER_ID}"
-      FILE_SET module_providers
-      DESTINATION "${junk_prefix}${install_dir}/module_interface/${target}"
-    )
-    install(
-      EXPORT ${target}
-      DESTINATION "${junk_prefix}${CMAKE_INSTALL_LIBDIR}/cmake"
-      FILE ${target}.maud-config.cmake
-      # TODO support injecting more cmake into maud-config.cmake
+    set(option "-fprebuilt-module-path=${bmi_dir_${CONFIG}}")
+    target_compile_options(${target} INTERFACE "$<${condition}:${option}>")
+    file(
+      GLOB config_bmis
+      "${bmi_dir_${CONFIG}}/${target}.pcm"
+      "${bmi_dir_${CONFIG}}/${target}-*.pcm"
     )
+    foreach(bmi ${config_bmis})
+      list(APPEND bmis "$<${condition}:${bmi}>")
+    endforeach()
   endforeach()
+  foreach(import ${_maud_bmi_imports})
+    if(TARGET ${import})
+      get_target_property(import_bmis ${import} MAUD_PREBUILT_BMIS)
+      list(APPEND bmis ${import_bmis})
+    endif()
+  endforeach()
+  list(REMOVE_DUPLICATES bmis)
+  set_target_properties(${target} PROPERTIES MAUD_PREBUILT_BMIS "${bmis}")
 endfunction()
 
 
@@ -785,6 +1958,27 @@ function(_maud_maybe_regenerate)
     unset(old)
   endif()
 
+  set(stamp "${MAUD_DIR}/options/global_references")
+  if(EXISTS "${stamp}")
+    foreach(file ${_MAUD_OPTION_READERS})
+      if("${stamp}" IS_NEWER_THAN "${file}")
+        continue()
+      endif()
+      set(readers ${_MAUD_OPTION_READERS})
+      list(REMOVE_ITEM readers ${_MAUD_CXX_SCANNED_SOURCES})
+      _maud_option_references(new_references ${readers})
+      file(READ "${stamp}" old_references)
+      if(NOT old_references STREQUAL new_references)
+        message(STATUS "change in options named by headers detected, will regenerate")
+        file(TOUCH_NOCREATE "${CMAKE_BINARY_DIR}/CMakeFiles/cmake.verify_globs")
+      else()
+        file(TOUCH "${stamp}")
+      endif()
+      break()
+    endforeach()
+  endif()
+
+  _maud_option_lookup()
   foreach(source_file ${_MAUD_CXX_SCANNED_SOURCES})
     _maud_rescan("${source_file}" scan-results-differ)
     if(scan-results-differ)
@@ -895,8 +2089,8 @@ function(_maud_setup)
   _maud_set(CMAKE_EXPORT_COMPILE_COMMANDS ON)
 
   _maud_load_cache(CONFIGURING)
-  unset(_MAUD_ALL_OPTIONS CACHE)
   unset(_MAUD_ALL_OPTIONS_RESOLVED CACHE)
+  unset(_MAUD_TEST_MAIN CACHE)
 
   if(NOT DEFINED _MAUD_ALL)
     _maud_glob(_MAUD_ALL "${CMAKE_SOURCE_DIR}")
@@ -905,8 +2099,8 @@ function(_maud_setup)
 
   file(REMOVE "${CMAKE_BINARY_DIR}/CMakeFiles/VerifyGlobs.cmake")
 
-  file(
-    WRITE "${MAUD_DIR}/eval.cmake"
+  _maud_write_if_different(
+    "${MAUD_DIR}/eval.cmake"
     "
     include(\"${_MAUD_SELF_DIR}/Maud.cmake\")
     _maud_load_cache(\"${CMAKE_BINARY_DIR}\")
@@ -915,7 +2109,9 @@ function(_maud_setup)
   )
 
   file(MAKE_DIRECTORY "${MAUD_DIR}/junk" "${MAUD_DIR}/rendered")
-  file(WRITE "${MAUD_DIR}/options.h" "")
+  if(NOT EXISTS "${MAUD_DIR}/options.h")
+    file(WRITE "${MAUD_DIR}/options.h" "")
+  endif()
   add_compile_options("${_MAUD_INCLUDE} \"${MAUD_DIR}/options.h\"")
 
   cmake_path(IS_PREFIX CMAKE_SOURCE_DIR "${CMAKE_BINARY_DIR}" is_prefix)
@@ -992,6 +2188,51 @@ function(_maud_setup)
     STRING "A ;-list of builders which will be used with Sphinx."
     DEFAULT "dirhtml"
   )
+
+  option(
+    MAUD_REDUCED_BMI
+    BOOL "Omit everything importers don't need from BMIs (Clang 18 and later)."
+    DEFAULT ON
+    MARK_AS_ADVANCED
+  )
+
+  option(
+    MAUD_AUTOMATIC_PCH
+    BOOL "Precompile headers which most of a target's non-module units include."
+    MARK_AS_ADVANCED
+  )
+
+  option(
+    MAUD_AUTOMATIC_PCH_THRESHOLD
+    STRING "The percentage of a target's non-module units which must include a header."
+    DEFAULT 50
+    MARK_AS_ADVANCED
+  )
+
+  option(
+    MAUD_COMPILE_CACHE
+    BOOL "Reuse objects and BMIs which Clang compiled from identical inputs in any build."
+    MARK_AS_ADVANCED
+  )
+  if(WIN32)
+    set(cache_home "$ENV{LOCALAPPDATA}")
+  elseif(DEFINED ENV{XDG_CACHE_HOME})
+    set(cache_home "$ENV{XDG_CACHE_HOME}")
+  else()
+    set(cache_home "$ENV{HOME}/.cache")
+  endif()
+  option(
+    MAUD_COMPILE_CACHE_DIR
+    PATH "The directory in which MAUD_COMPILE_CACHE stores objects and BMIs."
+    DEFAULT "${cache_home}/maud/compile"
+    MARK_AS_ADVANCED
+  )
+
+  option(
+    MAUD_APIDOC_PATTERNS
+    STRING "If provided, /// will be extracted from files matching these glob patterns."
+    MARK_AS_ADVANCED
+  )
   # PATH options are always coerced to absolute, relative to the working directory
   # of the configuring cmake process. Therefore we need to have that directory correctly
   # detect changes to PATH options.
@@ -1056,7 +2297,6 @@ endfunction()
 
 function(_maud_render_in2)
   file(WRITE "${compiled}" "")
-  file(WRITE "${RENDER_FILE}" "")
 
   execute_process(
     COMMAND "${_MAUD_IN2}"
@@ -1065,11 +2305,80 @@ function(_maud_render_in2)
     COMMAND_ERROR_IS_FATAL ANY
   )
 
+  _maud_render_compiled_in2()
+endfunction()
+
+
+# Templates are rendered to a staging file beside the compiled template, which is
+# then copied over the rendered file only if different (so that unchanged renderings
+# don't cause rebuilds). The staging file is left behind if rendering fails, so it
+# mustn't be in the globbed rendered directory. This doesn't depend on MAUD_DIR,
+# which batches rendered with cmake -P don't define.
+function(_maud_render_compiled_in2)
+  set(rendered "${RENDER_FILE}")
+  set(RENDER_FILE "${compiled}.staging")
+  file(WRITE "${RENDER_FILE}" "")
   include("${compiled}")
+
+  file(COPY_FILE "${RENDER_FILE}" "${rendered}" ONLY_IF_DIFFERENT)
+  file(REMOVE "${RENDER_FILE}")
+endfunction()
+
+
+# Render a batch of compiled templates in a single process. The manifest is
+# a JSON array of objects like
+#
+#   {"compiled": "foo.in2.cmake", "rendered": "foo", "definitions": {"FOO": "..."}}
+#
+# Each template is rendered in its own function scope with its definitions.
+# Errors in a template are fatal, so "started <i>" and "rendered <i>" lines are
+# appended to the status file around each render. A case which was started but
+# not rendered failed with whatever error text the process printed last; the rest
+# of the batch can be rendered by calling again with first set past it.
+function(_maud_render_in2_batch manifest status_file first)
+  file(READ "${manifest}" json)
+  string(JSON count LENGTH "${json}")
+  if(first GREATER_EQUAL count)
+    return()
+  endif()
+
+  math(EXPR last "${count} - 1")
+  foreach(i RANGE ${first} ${last})
+    file(APPEND "${status_file}" "started ${i}\n")
+    _maud_render_in2_batch_case()
+    file(APPEND "${status_file}" "rendered ${i}\n")
+  endforeach()
+endfunction()
+
+
+function(_maud_render_in2_batch_case)
+  string(JSON _maud_case GET "${json}" ${i})
+
+  # Don't leak the batch's bookkeeping into the template. This happens before the
+  # definitions are applied, since they may reuse any of these names.
+  foreach(_maud_var manifest status_file first json count last i)
+    unset(${_maud_var})
+  endforeach()
+
+  string(JSON compiled GET "${_maud_case}" compiled)
+  string(JSON RENDER_FILE GET "${_maud_case}" rendered)
+  string(JSON _maud_defs ERROR_VARIABLE _maud_no_defs GET "${_maud_case}" definitions)
+  if(NOT _maud_no_defs)
+    string(JSON _maud_count LENGTH "${_maud_defs}")
+    if(_maud_count GREATER 0)
+      math(EXPR _maud_last "${_maud_count} - 1")
+      foreach(_maud_d RANGE ${_maud_last})
+        string(JSON _maud_name MEMBER "${_maud_defs}" ${_maud_d})
+        string(JSON "${_maud_name}" GET "${_maud_defs}" "${_maud_name}")
+      endforeach()
+    endif()
+  endif()
+  _maud_render_compiled_in2()
 endfunction()
 
 
 function(_maud_setup_doc)
+  unset(_MAUD_SPHINX_PYTHON CACHE)
   find_package(Python3)
   if(NOT TARGET Python3::Interpreter)
     # TODO instead, error here (but include instructions to disable doc)
@@ -1105,26 +2414,23 @@ function(_maud_setup_doc)
 
   set(doc "${CMAKE_BINARY_DIR}/documentation")
 
-  file(REMOVE_RECURSE "${doc}")
+  # The staged tree and doctrees are kept between configures so that sphinx only
+  # reads documents which actually changed.
   file(MAKE_DIRECTORY "${doc}/stage")
   # TODO verify that this link is sufficient to literalinclude and document it
-  file(CREATE_LINK "${CMAKE_SOURCE_DIR}" "${doc}/stage/CMAKE_SOURCE_DIR" SYMBOLIC)
+  set(link "${doc}/stage/CMAKE_SOURCE_DIR")
+  set(linked)
+  if(IS_SYMLINK "${link}")
+    file(READ_SYMLINK "${link}" linked)
+  endif()
+  if(NOT linked STREQUAL CMAKE_SOURCE_DIR)
+    file(REMOVE "${link}")
+    file(CREATE_LINK "${CMAKE_SOURCE_DIR}" "${link}" SYMBOLIC)
+  endif()
 
-  file(
-    WRITE "${MAUD_DIR}/maud_sphinx_adapter/pyproject.toml"
-    [[
-      [build-system]
-      requires = ["setuptools"]
-      build-backend = "setuptools.build_meta"
-      [project]
-      name = "maud"
-      version = "0.0.1"
-      dependencies = []
-    ]]
-  )
-  file(WRITE "${MAUD_DIR}/maud_sphinx_adapter/maud/cache/__init__.py")
-  file(
-    WRITE "${MAUD_DIR}/maud_sphinx_adapter/maud/__init__.py"
+  _maud_write_if_different("${MAUD_DIR}/maud_sphinx_adapter/maud/cache/__init__.py" "")
+  string(
+    CONCAT adapter
     "import sys\n"
     "sys.path.append('${_MAUD_SELF_DIR}')\n"
     "from _maud_sphinx_adapter import setup, read_cache\n"
@@ -1132,26 +2438,19 @@ function(_maud_setup_doc)
     "import maud.cache\n"
     "read_cache('${CMAKE_BINARY_DIR}', maud.cache)\n"
   )
+  _maud_write_if_different("${MAUD_DIR}/maud_sphinx_adapter/maud/__init__.py" "${adapter}")
 
-  message(STATUS "Building virtual env ${doc}/venv for Sphinx")
-  execute_process(COMMAND "${Python3_EXECUTABLE}" -m venv --clear "${doc}/venv")
-  execute_process(
-    COMMAND
-      "${doc}/venv/bin/pip" install
-      --editable "${MAUD_DIR}/maud_sphinx_adapter"
-      --editable "${_MAUD_SELF_DIR}/trike"
-      --requirement "${_MAUD_SELF_DIR}/sphinx_requirements.txt"
-      --isolated
-      --require-virtualenv
-      --ignore-installed
-      --disable-pip-version-check
-      --no-input
-      --quiet
-      --log "${doc}/venv/pip.log"
-      --report "${doc}/venv/pip.report.json"
-    COMMAND_ERROR_IS_FATAL ANY
+  _maud_sphinx_venv(venv_python)
+  # The adapter and trike are imported from where they are rather than installed,
+  # since they are specific to this build and this installation of Maud.
+  set(
+    PYTHON
+    "${CMAKE_COMMAND}" -E env
+    --modify "PYTHONPATH=path_list_prepend:${MAUD_DIR}/maud_sphinx_adapter"
+    --modify "PYTHONPATH=path_list_prepend:${_MAUD_SELF_DIR}/trike"
+    "${venv_python}"
   )
-  set(SPHINX_BUILD "${doc}/venv/bin/sphinx-build")
+  _maud_set(_MAUD_SPHINX_PYTHON "${PYTHON}")
 
   set(ext_regex "${MAUD_CXX_HEADER_EXTENSIONS}")
   string(REPLACE "+" "[+]" ext_regex "${ext_regex}")
@@ -1171,7 +2470,8 @@ function(_maud_setup_doc)
     add_custom_command(
       OUTPUT "${staged}"
       DEPENDS "${file}"
-      COMMAND "${CMAKE_COMMAND}" -E copy "${file}" "${staged}"
+      # An unchanged copy keeps its timestamp, so sphinx won't read it again.
+      COMMAND "${CMAKE_COMMAND}" -E copy_if_different "${file}" "${staged}"
       COMMENT "Staging${file}$<$<BOOL:${is_gen}>: (generated)> to ${staged}"
     )
     list(APPEND all_staged "${staged}")
@@ -1179,16 +2479,127 @@ function(_maud_setup_doc)
 
   # TODO assert there are no dupes in all_staged = collision between source/generated
 
-  add_custom_target(documentation ALL)
+  # Documents which were staged by a previous configure but no longer exist
+  # would otherwise still be built.
+  file(GLOB_RECURSE stale LIST_DIRECTORIES false "${doc}/stage/*.rst")
+  list(REMOVE_ITEM stale ${all_staged})
+  if(stale)
+    file(REMOVE ${stale})
+  endif()
+
+  # Extract /// from each documented file to JSON in a build edge of its own, so
+  # that extraction is incremental and parallel. (Otherwise trike scans the
+  # files listed in conf.py from inside sphinx.)
+  set(all_apidoc)
+  set(trike_manifest)
+  if(MAUD_APIDOC_PATTERNS)
+    if(NOT "CONFIGURE_DEPENDS;${MAUD_APIDOC_PATTERNS}" STREQUAL
+        "${_MAUD_GLOB_ARGUMENTS__MAUD_APIDOC}")
+      unset(_MAUD_APIDOC CACHE)
+    endif()
+    glob(_MAUD_APIDOC CONFIGURE_DEPENDS ${MAUD_APIDOC_PATTERNS})
+
+    set(trike_config "${MAUD_DIR}/apidoc/config.json")
+    add_custom_command(
+      OUTPUT "${trike_config}"
+      DEPENDS "${conf_dir}/conf.py"
+      WORKING_DIRECTORY "${conf_dir}"
+      COMMAND ${PYTHON} -m trike config "${conf_dir}" "${trike_config}"
+      COMMENT "Reading trike configuration from ${conf_dir}/conf.py"
+    )
+
+    # maud_apidoc extracts most files without libclang,
+    # falling back to trike for anything it can't classify.
+    if(TARGET maud_apidoc)
+      set(extractor "$<TARGET_FILE:maud_apidoc>")
+    else()
+      find_program(_MAUD_APIDOC_EXTRACTOR maud_apidoc)
+      mark_as_advanced(_MAUD_APIDOC_EXTRACTOR)
+      set(extractor "${_MAUD_APIDOC_EXTRACTOR}")
+    endif()
+
+    set(manifest_entries)
+    foreach(file ${_MAUD_APIDOC})
+      _maud_relative_path("${file}" relative is_gen)
+      if(is_gen)
+        set(json "${MAUD_DIR}/apidoc/rendered/${relative}.json")
+      else()
+        set(json "${MAUD_DIR}/apidoc/source/${relative}.json")
+      endif()
+
+      set(
+        command
+        ${PYTHON} -m trike extract
+        "${trike_config}" "${file}" "${json}" --depfile "${json}.d"
+      )
+      if(extractor)
+        list(PREPEND command "${extractor}" "${file}" "${json}" "${json}.d" --)
+      endif()
+      add_custom_command(
+        OUTPUT "${json}"
+        DEPENDS "${file}" "${trike_config}" ${extractor}
+        DEPFILE "${json}.d"
+        COMMAND ${command}
+        COMMENT "Extracting /// from ${file}"
+      )
+      list(APPEND all_apidoc "${json}")
+      list(APPEND manifest_entries "\"${file}\": \"${json}\"")
+    endforeach()
+
+    list(JOIN manifest_entries ",\n  " manifest)
+    _maud_write_if_different("${MAUD_DIR}/apidoc/manifest.json" "{\n  ${manifest}\n}\n")
+    set(trike_manifest --define "trike_json_manifest=${MAUD_DIR}/apidoc/manifest.json")
+  endif()
 
-  # We run sphinx multithreaded. This can pessimize throughput since ninja
-  # is probably *also* running `nproc` tasks. If this becomes a problem later,
-  # there will need to be an option or some other way to mediate between sphinx
-  # and ninja. In the meantime, ensure that at least sphinx isn't trying to build
+  # We run sphinx in parallel, but ninja is probably *also* running `nproc`
+  # tasks. When the build tool provides a jobserver, sphinx only takes as many
+  # jobs as it can borrow from that (otherwise it takes the whole machine).
+  # Builders share doctrees, so ensure that sphinx isn't trying to build
   # manpages and html at the same time.
   set_property(GLOBAL APPEND PROPERTY JOB_POOLS sphinx_build=1)
 
-  set(all_build_logs)
+  # Since the doctrees are shared, documents are read and resolved by the first
+  # builder and the rest only write their output. The default builders are run
+  # together in a single process, so that's only paid for once per build.
+  set(
+    sphinx_build
+    "${Python3_EXECUTABLE}" "${_MAUD_SELF_DIR}/_maud_jobserver.py"
+    ${PYTHON} "${_MAUD_SELF_DIR}/_maud_sphinx_build.py"
+    --conf-dir "${conf_dir}"
+    --jobs JOBS
+    ${trike_manifest}
+    stage     # use stage as source directory
+    doctrees  # each builder gets an independent build directory next to this
+  )
+  set(
+    sphinx_depends
+    ${all_staged}
+    ${all_apidoc}
+    # FIXME note all of these with Sphinx.env.note_dependency()
+    # if they aren't already noted.
+    "${conf_dir}/conf.py"
+    "${_MAUD_SELF_DIR}/_maud_sphinx_build.py"
+  )
+
+  set(default_logs)
+  foreach(builder ${SPHINX_BUILDERS})
+    list(APPEND default_logs "${doc}/${builder}.log")
+  endforeach()
+  if(default_logs)
+    list(JOIN SPHINX_BUILDERS ", " builders)
+    add_custom_command(
+      OUTPUT ${default_logs}
+      DEPENDS ${sphinx_depends}
+      WORKING_DIRECTORY "${doc}"
+      COMMAND ${sphinx_build} ${SPHINX_BUILDERS}
+      JOB_POOL sphinx_build
+      JOB_SERVER_AWARE ON
+      COMMAND_EXPAND_LISTS
+      COMMENT "Building ${builders} with sphinx"
+    )
+  endif()
+  add_custom_target(documentation ALL DEPENDS ${default_logs})
+
   foreach(
     builder
 
@@ -1200,36 +2611,82 @@ function(_maud_setup_doc)
     doctest linkcheck
     xml pseudoxml
   )
-    add_custom_command(
-      OUTPUT "${doc}/${builder}.log"
-      DEPENDS
-        ${all_staged}
-        # FIXME note all of these with Sphinx.env.note_dependency()
-        # if they aren't already noted.
-        "${conf_dir}/conf.py"
-      WORKING_DIRECTORY "${doc}"
-      COMMAND
-        "${SPHINX_BUILD}"
-        --builder ${builder}
-        --conf-dir "${conf_dir}"
-        --doctree-dir doctrees
-        --jobs auto
-        stage       # use stage as source directory
-        ${builder}  # provide an independent build directory to each builder
-        > ${builder}.log
-      JOB_POOL sphinx_build
-      COMMAND_EXPAND_LISTS
-      COMMENT "Building ${builder} with sphinx"
-    )
-    add_custom_target(documentation.${builder} DEPENDS "${doc}/${builder}.log")
-
-    if("${builder}" IN_LIST SPHINX_BUILDERS)
-      add_dependencies(documentation documentation.${builder})
+    if(NOT "${builder}" IN_LIST SPHINX_BUILDERS)
+      add_custom_command(
+        OUTPUT "${doc}/${builder}.log"
+        DEPENDS ${sphinx_depends}
+        WORKING_DIRECTORY "${doc}"
+        COMMAND ${sphinx_build} ${builder}
+        JOB_POOL sphinx_build
+        JOB_SERVER_AWARE ON
+        COMMAND_EXPAND_LISTS
+        COMMENT "Building ${builder} with sphinx"
+      )
     endif()
+    add_custom_target(documentation.${builder} DEPENDS "${doc}/${builder}.log")
   endforeach()
 endfunction()
 
 
+# Sphinx's virtual env is shared between build directories, keyed by everything
+# which determines its contents. It is only built if no matching one exists.
+function(_maud_sphinx_venv out_var)
+  file(SHA256 "${_MAUD_SELF_DIR}/sphinx_requirements.txt" requirements_hash)
+  file(SHA256 "${_MAUD_SELF_DIR}/trike/pyproject.toml" trike_hash)
+  string(
+    SHA256 hash
+    "${requirements_hash};${trike_hash};${Python3_EXECUTABLE};${Python3_VERSION}"
+  )
+  string(SUBSTRING "${hash}" 0 16 hash)
+
+  if(DEFINED ENV{XDG_CACHE_HOME})
+    set(cache "$ENV{XDG_CACHE_HOME}")
+  elseif(WIN32 AND DEFINED ENV{LOCALAPPDATA})
+    set(cache "$ENV{LOCALAPPDATA}")
+  else()
+    set(cache "$ENV{HOME}/.cache")
+  endif()
+  cmake_path(SET venv NORMALIZE "${cache}/maud/venv/${hash}")
+
+  if(WIN32)
+    set(python "${venv}/Scripts/python.exe")
+  else()
+    set(python "${venv}/bin/python")
+  endif()
+  set(${out_var} "${python}" PARENT_SCOPE)
+
+  # Another configure may be building the same venv concurrently
+  file(MAKE_DIRECTORY "${cache}/maud/venv")
+  file(LOCK "${venv}.lock" GUARD FUNCTION TIMEOUT 600)
+  if(EXISTS "${venv}/maud.stamp" AND EXISTS "${python}")
+    message(VERBOSE "Reusing virtual env ${venv} for Sphinx")
+    return()
+  endif()
+
+  message(STATUS "Building virtual env ${venv} for Sphinx")
+  execute_process(
+    COMMAND "${Python3_EXECUTABLE}" -m venv --clear "${venv}"
+    COMMAND_ERROR_IS_FATAL ANY
+  )
+  execute_process(
+    COMMAND
+      "${python}" -m pip install
+      --requirement "${_MAUD_SELF_DIR}/sphinx_requirements.txt"
+      --isolated
+      --require-virtualenv
+      --ignore-installed
+      --disable-pip-version-check
+      --no-input
+      --quiet
+      --log "${venv}/pip.log"
+      --report "${venv}/pip.report.json"
+    COMMAND_ERROR_IS_FATAL ANY
+  )
+  # Written last, so that an interrupted install is not mistaken for a complete one
+  file(WRITE "${venv}/maud.stamp" "${Python3_EXECUTABLE} ${Python3_VERSION}\n")
+endfunction()
+
+
 function(shim_script_as destination script)
   cmake_path(ABSOLUTE_PATH script)
 
@@ -1332,7 +2789,7 @@ function(option name type)
   endif()
   _maud_set(_MAUD_DECLARED_${name} ON)
   _maud_set(_MAUD_OPTION_GROUP_${name} "${OPTION_GROUP}")
-  _maud_set_include(_MAUD_ALL_OPTIONS ${name})
+  _maud_list_option(${name})
 
   if(
     DEFINED ENV{${name}}
@@ -1429,28 +2886,39 @@ function(option name type)
 endfunction()
 
 
+# The set of all options and the graph of requirements between them are only
+# needed while configuring, so they are kept in global properties rather than
+# the cache (where appending to a deduplicated list is linear in its length).
+function(_maud_list_option name)
+  get_property(listed GLOBAL PROPERTY _MAUD_LISTED_${name} SET)
+  if(NOT listed)
+    set_property(GLOBAL PROPERTY _MAUD_LISTED_${name} ON)
+    set_property(GLOBAL APPEND PROPERTY _MAUD_ALL_OPTIONS ${name})
+  endif()
+endfunction()
+
+
 function(_maud_assert_or_store_requirement name condition dependency required_value)
-  _maud_set_include(_MAUD_MAYBE_CONSTRAINED_BY_${dependency} ${name})
-  _maud_set_include(_MAUD_ALL_OPTIONS ${dependency})
-  string(SHA512 hash "${dependency}-${name}-${condition}")
+  _maud_list_option(${dependency})
+  string(MD5 hash "${dependency}-${name}-${condition}")
 
   if(NOT DEFINED CACHE{_MAUD_RESOLVED_${name}})
     # Just store the requirement for later;
     # we can't do anything until ${name} is resolved
     _maud_type_check_option(${dependency} "${required_value}")
-    _maud_set(_MAUD_REQUIREMENT_${hash} "${required_value}")
-    _maud_set_include(_MAUD_RESOLVE_BEFORE_${dependency} ${name})
-    _maud_set_include(_MAUD_REQUIREMENTS ${hash})
+    set_property(GLOBAL PROPERTY _MAUD_REQUIREMENT_${hash} "${required_value}")
+    set_property(GLOBAL APPEND PROPERTY _MAUD_RESOLVE_BEFORE_${dependency} ${name})
     _maud_watch_option(${dependency})
     return()
   endif()
 
-  string(SHA512 hash "${dependency}-${name}-$CACHE{${name}}")
-  if(NOT DEFINED CACHE{_MAUD_REQUIREMENT_${hash}})
+  string(MD5 hash "${dependency}-${name}-$CACHE{${name}}")
+  get_property(required GLOBAL PROPERTY _MAUD_REQUIREMENT_${hash} SET)
+  if(NOT required)
     # ${name} does not place a requirement on ${dependency}
     return()
   endif()
-  set(required_value "${_MAUD_REQUIREMENT_${hash}}")
+  get_property(required_value GLOBAL PROPERTY _MAUD_REQUIREMENT_${hash})
   _maud_type_check_option(${dependency} "${required_value}")
 
   _maud_set_include(_MAUD_CONSTRAINTS_ON_${dependency} ${name})
@@ -1509,23 +2977,81 @@ function(_maud_type_check_option name value)
 endfunction()
 
 
-function(_maud_ensure_option_resolved name path)
-  if(DEFINED CACHE{_MAUD_RESOLVED_${name}})
-    return()
-  endif()
+# Resolve each of the named options (and everything they depend on).
+#
+# Each option is resolved only after every option which might constrain it, so
+# this is a depth first traversal of the requirement graph. It's iterative since
+# chains of requirements may be deeper than CMake's recursion limit.
+function(_maud_ensure_options_resolved)
+  # variable_watch() can re-enter this function (if VALIDATE reads another option,
+  # for example) and functions inherit their caller's variables, so traversal
+  # state is namespaced per call.
+  get_property(call GLOBAL PROPERTY _MAUD_RESOLUTION_CALLS)
+  math(EXPR call "${call} + 1")
+  set_property(GLOBAL PROPERTY _MAUD_RESOLUTION_CALLS ${call})
+  set(_ "_maud_resolution_${call}_")
+
+  # The stack and path are numbered variables rather than lists,
+  # since each list operation would be linear in their length.
+  set(top 0)
+  set(depth 0)
+  set(roots ${ARGN})
+  list(REVERSE roots)
+  foreach(name ${roots})
+    math(EXPR top "${top} + 1")
+    set(${_}stack_${top} ${name})
+  endforeach()
 
-  if(name IN_LIST path)
-    message(
-      FATAL_ERROR
-      "
+  while(top GREATER 0)
+    set(name "${${_}stack_${top}}")
+    math(EXPR top "${top} - 1")
+
+    if(name MATCHES "^>(.*)$")
+      # everything which might constrain this option is resolved
+      set(name "${CMAKE_MATCH_1}")
+      math(EXPR depth "${depth} - 1")
+      if(NOT DEFINED CACHE{_MAUD_RESOLVED_${name}})
+        _maud_resolve_option(${name})
+      endif()
+      continue()
+    endif()
+
+    if(DEFINED CACHE{_MAUD_RESOLVED_${name}})
+      continue()
+    endif()
+
+    if(DEFINED ${_}visiting_${name})
+      set(path)
+      foreach(i RANGE 1 ${depth})
+        list(APPEND path ${${_}path_${i}})
+      endforeach()
+      message(
+        FATAL_ERROR
+        "
     Cyclic constraint between options
       ${path}
-      "
-    )
-  endif()
+        "
+      )
+    endif()
+    set(${_}visiting_${name} ON)
+    math(EXPR depth "${depth} + 1")
+    set(${_}path_${depth} ${name})
+
+    math(EXPR top "${top} + 1")
+    set(${_}stack_${top} ">${name}")
+    get_property(dependents GLOBAL PROPERTY _MAUD_RESOLVE_BEFORE_${name})
+    foreach(dependent ${dependents})
+      math(EXPR top "${top} + 1")
+      set(${_}stack_${top} ${dependent})
+    endforeach()
+  endwhile()
+endfunction()
+
 
-  foreach(dependent ${_MAUD_RESOLVE_BEFORE_${name}})
-    _maud_ensure_option_resolved(${dependent} "${path};${name}")
+function(_maud_resolve_option name)
+  get_property(dependents GLOBAL PROPERTY _MAUD_RESOLVE_BEFORE_${name})
+  list(REMOVE_DUPLICATES dependents)
+  foreach(dependent ${dependents})
     _maud_assert_or_store_requirement(
       ${dependent} $CACHE{${dependent}}
       ${name} ""
@@ -1558,25 +3084,39 @@ function(_maud_ensure_option_resolved name path)
   string_unescape("${help}" help)
   string(REPLACE "\n" "\n/// " help "\n${help}")
 
+  # Each option gets a header of its own. (See _maud_option_headers for how
+  # they are included.)
+  set(header "#pragma once\n")
   if(type STREQUAL "BOOL")
+    set(macros ${name})
     if($CACHE{${name}})
-      file(APPEND "${MAUD_DIR}/options.h" "${help}\n#define ${name} 1\n")
+      string(APPEND header "${help}\n#define ${name} 1\n")
     else()
-      file(APPEND "${MAUD_DIR}/options.h" "${help}\n#define ${name} 0\n")
+      string(APPEND header "${help}\n#define ${name} 0\n")
     endif()
   elseif(enum)
+    set(macros)
     foreach(e ${enum})
-      file(APPEND "${MAUD_DIR}/options.h" "${help}\n/// ($CACHE{${name}} of ${enum})")
+      list(APPEND macros ${name}_${e})
+      string(APPEND header "${help}\n/// ($CACHE{${name}} of ${enum})")
       if("$CACHE{${name}}" STREQUAL "${e}")
-        file(APPEND "${MAUD_DIR}/options.h" "\n#define ${name}_${e} 1\n")
+        string(APPEND header "\n#define ${name}_${e} 1\n")
       else()
-        file(APPEND "${MAUD_DIR}/options.h" "\n#define ${name}_${e} 0\n")
+        string(APPEND header "\n#define ${name}_${e} 0\n")
       endif()
     endforeach()
   else()
+    set(macros ${name})
     string_escape("$CACHE{${name}}" esc)
-    file(APPEND "${MAUD_DIR}/options.h" "${help}\n#define ${name} \"${esc}\"\n")
+    string(APPEND header "${help}\n#define ${name} \"${esc}\"\n")
   endif()
+
+  _maud_write_if_different("${MAUD_DIR}/options/${name}.h" "${header}")
+
+  foreach(macro ${macros})
+    set_property(GLOBAL PROPERTY _MAUD_OPTION_OF_${macro} ${name})
+  endforeach()
+  set_property(GLOBAL APPEND PROPERTY _MAUD_OPTION_MACROS ${macros})
 endfunction()
 
 
@@ -1598,7 +3138,7 @@ function(_maud_watch_option name)
         "Manually setting option ${name} whose value is already resolved"
       )
     endif()
-    _maud_ensure_option_resolved(${name} "")
+    _maud_ensure_options_resolved(${name})
   endfunction()
 
   variable_watch(${name} _maud_option_watcher)
@@ -1607,7 +3147,8 @@ endfunction()
 
 
 function(_maud_resolve_options)
-  foreach(name ${_MAUD_ALL_OPTIONS})
+  get_property(all_options GLOBAL PROPERTY _MAUD_ALL_OPTIONS)
+  foreach(name ${all_options})
     if(NOT DEFINED CACHE{_MAUD_DECLARED_${name}})
       message(
         WARNING
@@ -1617,21 +3158,19 @@ function(_maud_resolve_options)
         "
       )
     endif()
-
-    _maud_ensure_option_resolved(${name} "")
   endforeach()
-
-  foreach(hash ${_MAUD_REQUIREMENTS})
-    unset(_MAUD_REQUIREMENT_${hash} CACHE)
-  endforeach()
-  unset(_MAUD_REQUIREMENTS CACHE)
+  _maud_ensure_options_resolved(${all_options})
 
   _maud_set(_MAUD_ALL_OPTIONS_RESOLVED TRUE)
 endfunction()
 
 
 function(_maud_options_summary)
-  set(cache_json "{}")
+  get_property(all_options GLOBAL PROPERTY _MAUD_ALL_OPTIONS)
+  # JSON members are concatenated and parsed once at the end; string(JSON SET)
+  # per option would reparse the whole object each time.
+  set(cache_json)
+  set(comma)
 
   set(group "")
   message(
@@ -1650,7 +3189,7 @@ function(_maud_options_summary)
   endif()
 
   message(STATUS)
-  foreach(name ${_MAUD_ALL_OPTIONS})
+  foreach(name ${all_options})
     unset(user_value)
     if(DEFINED CACHE{_MAUD_DEFINITELY_USER_${name}})
       set(user_value "${_MAUD_DEFINITELY_USER_${name}}")
@@ -1666,7 +3205,8 @@ function(_maud_options_summary)
 
     string_escape("$CACHE{${name}}" quoted)
     set(quoted "\"${quoted}\"")
-    string(JSON cache_json SET "${cache_json}" ${name} "${quoted}")
+    string(APPEND cache_json "${comma}\"${name}\": ${quoted}")
+    set(comma ", ")
 
     get_property(advanced CACHE ${name} PROPERTY ADVANCED)
     if(advanced AND "$CACHE{${name}}" STREQUAL "${_MAUD_DEFAULT_${name}}")
@@ -1730,7 +3270,7 @@ function(_maud_options_summary)
   string(TIMESTAMP timestamp)
   string(JSON preset SET "${preset}" name "\"${timestamp}\"")
   string(JSON preset SET "${preset}" generator "\"${CMAKE_GENERATOR}\"")
-  string(JSON preset SET "${preset}" cacheVariables "${cache_json}")
+  string(JSON preset SET "${preset}" cacheVariables "{${cache_json}}")
   string(
     JSON preset SET "${preset}"
     environment "{\"MAUD_DISABLE_ENVIRONMENT_OPTIONS\": \"ON\"}"
@@ -1753,7 +3293,7 @@ function(_maud_options_summary)
   file(WRITE "${CMAKE_SOURCE_DIR}/CMakeUserPresets.json" "${presets}\n")
 
   # Clear temporaries
-  foreach(name ${_MAUD_ALL_OPTIONS})
+  foreach(name ${all_options})
     foreach(
       prefix
       DEFAULT
@@ -1763,7 +3303,6 @@ function(_maud_options_summary)
       DEFINITELY_USER
       ADD_COMPILE_DEFINITIONS
       VALIDATE
-      MAYBE_CONSTRAINED_BY
       CONSTRAINTS_ON
     )
       unset(_MAUD_${prefix}_${name} CACHE)
@@ -1772,6 +3311,104 @@ function(_maud_options_summary)
 endfunction()
 
 
+# Options with ADD_COMPILE_DEFINITIONS are force included only into the scanned
+# sources which name one of their macros, so that changing an option's value only
+# rebuilds the sources which read it. Headers and unscanned sources might be
+# included into anything, so options which they name go into options.h (which is
+# force included into every translation unit).
+function(_maud_option_headers)
+  get_property(macros GLOBAL PROPERTY _MAUD_OPTION_MACROS)
+  _maud_set(_MAUD_OPTION_MACROS "${macros}")
+  _maud_option_lookup()
+
+  set(stamp "${MAUD_DIR}/options/global_references")
+  set(scanned "${_MAUD_CXX_SCANNED_SOURCES}")
+  if(CMAKE_CXX_STANDARD LESS 20 OR NOT scanned)
+    # Without scanned sources, we can't tell which options anything reads.
+    set(global_macros ${macros})
+    set(scanned)
+    file(REMOVE "${stamp}")
+  else()
+    set(ext_regex "${MAUD_CXX_SOURCE_EXTENSIONS} ${MAUD_CXX_HEADER_EXTENSIONS}")
+    string(REPLACE "+" "[+]" ext_regex "${ext_regex}")
+    string(REPLACE " " "|" ext_regex "${ext_regex}")
+    glob(_MAUD_OPTION_READERS CONFIGURE_DEPENDS "[.](${ext_regex})$")
+
+    set(readers ${_MAUD_OPTION_READERS})
+    list(REMOVE_ITEM readers ${scanned})
+    _maud_option_references(global_macros ${readers})
+    file(WRITE "${stamp}" "${global_macros}")
+  endif()
+
+  set(options_h "")
+  foreach(macro ${global_macros})
+    get_property(option GLOBAL PROPERTY _MAUD_OPTION_OF_${macro})
+    string(APPEND options_h "#include \"options/${option}.h\"\n")
+  endforeach()
+  _maud_write_if_different("${MAUD_DIR}/options.h" "${options_h}")
+
+  foreach(source_file ${scanned})
+    _maud_option_references(source_macros "${source_file}")
+    _maud_get_ddi_path("${source_file}" ddi)
+    file(WRITE "${ddi}.options" "${source_macros}")
+
+    set(options)
+    foreach(macro ${source_macros})
+      if(NOT macro IN_LIST global_macros)
+        get_property(option GLOBAL PROPERTY _MAUD_OPTION_OF_${macro})
+        list(APPEND options ${option})
+      endif()
+    endforeach()
+    list(REMOVE_DUPLICATES options)
+    foreach(option ${options})
+      set_property(
+        SOURCE "${source_file}"
+        APPEND PROPERTY COMPILE_OPTIONS
+        "${_MAUD_INCLUDE} \"${MAUD_DIR}/options/${option}.h\""
+      )
+    endforeach()
+  endforeach()
+endfunction()
+
+
+# Find which option macros are named in the given files. This is a plain token
+# match, so a macro is only found if its full name is written out (not if it is
+# assembled by token pasting, for example).
+function(_maud_option_references out_var)
+  if(NOT _maud_option_lookup)
+    _maud_option_lookup()
+  endif()
+  set(references)
+  if(_MAUD_OPTION_MACROS)
+    foreach(file ${ARGN})
+      file(READ "${file}" content)
+      string(REGEX MATCHALL "[A-Za-z_][A-Za-z0-9_]*" tokens "${content}")
+      list(REMOVE_DUPLICATES tokens)
+      foreach(token ${tokens})
+        if(DEFINED _maud_option_macro_${token})
+          list(APPEND references ${token})
+        endif()
+      endforeach()
+    endforeach()
+    list(REMOVE_DUPLICATES references)
+    list(SORT references)
+  endif()
+  set(${out_var} "${references}" PARENT_SCOPE)
+endfunction()
+
+
+# Option macros are looked up by variable name rather than matched with a regex,
+# which would exceed CMake's limit on compiled regex size for many options. This
+# is a macro so that a caller which finds references in many files can define
+# the lookup once, rather than once per call of _maud_option_references.
+macro(_maud_option_lookup)
+  foreach(_maud_macro ${_MAUD_OPTION_MACROS})
+    set(_maud_option_macro_${_maud_macro} ON)
+  endforeach()
+  set(_maud_option_lookup ON)
+endmacro()
+
+
 ################################################################################
 # in2 helpers and pipeline filters
 ################################################################################
@@ -0,0 +1,98 @@
+"""Run a command with as many jobs as a GNU make-style jobserver will lend us.
+
+    python _maud_jobserver.py COMMAND... --jobs JOBS COMMAND...
+
+Each argument which is exactly ``JOBS`` is replaced with the number of jobs
+available: the implicit slot every job holds, plus however many tokens could be
+taken from the jobserver without waiting. The tokens are returned when the
+command exits. If there is no jobserver in ``MAKEFLAGS``, ``JOBS`` is replaced
+with ``auto`` and the command is left to size itself to the machine.
+"""
+
+import os
+import re
+import select
+import subprocess
+import sys
+
+AUTH = re.compile(r"--jobserver-(?:auth|fds)=(?:fifo:(?P<fifo>\S+)|(?P<r>\d+),(?P<w>\d+))")
+
+
+class Jobserver:
+    def __init__(self, makeflags: str):
+        self.read_fd = self.write_fd = None
+        self.owned = []
+        self.tokens = b""
+
+        # The last --jobserver-auth wins, as in make itself.
+        *_, match = [None, *AUTH.finditer(makeflags)]
+        if match is None or os.name == "nt":
+            return
+
+        try:
+            if fifo := match["fifo"]:
+                self.read_fd = os.open(fifo, os.O_RDONLY | os.O_NONBLOCK)
+                self.write_fd = os.open(fifo, os.O_WRONLY)
+                self.owned = [self.read_fd, self.write_fd]
+            else:
+                read_fd, self.write_fd = int(match["r"]), int(match["w"])
+                # The descriptors are only usable if they were inherited.
+                os.fstat(read_fd)
+                os.fstat(self.write_fd)
+                self.read_fd = self.reopen_nonblocking(read_fd)
+        except OSError:
+            self.read_fd = self.write_fd = None
+
+    def reopen_nonblocking(self, fd: int) -> int:
+        """Open an inherited pipe again so that reading it can't block.
+
+        Other clients share the inherited descriptor's flags and may expect it to
+        block, so it isn't changed. Where the pipe can't be opened again, reads are
+        only preceded by a poll (another client could still take the token first).
+        """
+        try:
+            reopened = os.open(f"/proc/self/fd/{fd}", os.O_RDONLY | os.O_NONBLOCK)
+        except OSError:
+            return fd
+        self.owned.append(reopened)
+        return reopened
+
+    def acquire(self, most: int):
+        """Take up to `most` tokens without blocking."""
+        while self.read_fd is not None and len(self.tokens) < most:
+            readable, _, _ = select.select([self.read_fd], [], [], 0)
+            if not readable:
+                break
+            try:
+                token = os.read(self.read_fd, 1)
+            except (BlockingIOError, InterruptedError):
+                break
+            if not token:
+                break
+            self.tokens += token
+
+    def release(self):
+        if self.tokens:
+            os.write(self.write_fd, self.tokens)
+            self.tokens = b""
+        for fd in self.owned:
+            os.close(fd)
+        self.owned = []
+
+
+def main(command: list[str]) -> int:
+    jobserver = Jobserver(os.environ.get("MAKEFLAGS", ""))
+    try:
+        if jobserver.read_fd is None:
+            jobs = "auto"
+        else:
+            jobserver.acquire((os.cpu_count() or 1) - 1)
+            jobs = str(len(jobserver.tokens) + 1)
+        command = [jobs if arg == "JOBS" else arg for arg in command]
+        return subprocess.call(command)
+    finally:
+        jobserver.release()
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,58 @@
+"""Build documentation with several Sphinx builders in a single process.
+
+    python _maud_sphinx_build.py --conf-dir DIR --jobs N [--define NAME=VALUE]...
+        SOURCE_DIR DOCTREE_DIR BUILDER...
+
+Each builder writes to a directory named after it, with its log in BUILDER.log.
+All builders share one doctree directory, so documents are read and resolved
+once; subsequent builders only write their own output. (Doctrees persist
+between runs too, so only changed documents are read again.)
+"""
+
+import argparse
+import os
+import sys
+from pathlib import Path
+
+from sphinx.application import Sphinx
+from sphinx.util.docutils import docutils_namespace, patch_docutils
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--conf-dir", type=Path, required=True)
+    parser.add_argument("--jobs", default="auto")
+    parser.add_argument("--define", action="append", default=[])
+    parser.add_argument("source_dir", type=Path)
+    parser.add_argument("doctree_dir", type=Path)
+    parser.add_argument("builders", nargs="+")
+    args = parser.parse_args()
+
+    jobs = (os.cpu_count() or 1) if args.jobs == "auto" else int(args.jobs)
+    overrides = dict(define.split("=", 1) for define in args.define)
+
+    for builder in args.builders:
+        log_path = Path(f"{builder}.log")
+        with log_path.open("w") as log:
+            with patch_docutils(args.conf_dir), docutils_namespace():
+                app = Sphinx(
+                    args.source_dir,
+                    args.conf_dir,
+                    Path(builder),
+                    args.doctree_dir,
+                    builder,
+                    confoverrides=overrides,
+                    status=log,
+                    warning=log,
+                    parallel=jobs,
+                )
+                app.build()
+
+        if app.statuscode != 0:
+            sys.stderr.write(log_path.read_text())
+            return app.statuscode
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,123 @@
+# Time configuring and building synthesized projects of increasing size:
+#
+#   cmake -D MAUD_BUILD_DIR=... -D CONFIG=... -D CXX=... -D SYNTHESIZE=...
+#         -D SCALES=1,4,16 -D OUTPUT_DIR=... -P maud_benchmark.cmake
+#
+# Maud is installed from MAUD_BUILD_DIR to ${OUTPUT_DIR}/usr, then for each scale
+# a project is written with SYNTHESIZE and timed with that installation:
+#
+# - fresh_configure_ms: generating the build directory from scratch
+# - build_ms: the first build
+# - no_op_build_ms: building again, which only checks whether to regenerate
+# - touched_rebuild_ms: building after touching one module interface
+# - reconfigure_ms: configuring the existing build directory again
+#
+# Results are written to ${OUTPUT_DIR}/results.json
+
+foreach(var MAUD_BUILD_DIR CONFIG CXX SYNTHESIZE SCALES OUTPUT_DIR)
+  if(NOT DEFINED ${var})
+    message(FATAL_ERROR "${var} must be defined")
+  endif()
+endforeach()
+string(REPLACE "," ";" SCALES "${SCALES}")
+
+function(run)
+  execute_process(
+    COMMAND ${ARGN}
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE output
+  )
+  if(NOT result EQUAL 0)
+    list(JOIN ARGN " " command)
+    message(FATAL_ERROR "${command} failed:\n${output}")
+  endif()
+endfunction()
+
+function(timed out_var)
+  string(TIMESTAMP begin "%s%f" UTC)
+  run(${ARGN})
+  string(TIMESTAMP end "%s%f" UTC)
+  math(EXPR ms "(${end} - ${begin}) / 1000")
+  set(${out_var} ${ms} PARENT_SCOPE)
+endfunction()
+
+set(usr "${OUTPUT_DIR}/usr")
+file(REMOVE_RECURSE "${usr}")
+run("${CMAKE_COMMAND}" --install "${MAUD_BUILD_DIR}" --prefix "${usr}" --config "${CONFIG}")
+set(maud_cli "${usr}/lib/cmake/Maud/maud_cli.cmake")
+if(NOT EXISTS "${maud_cli}")
+  file(GLOB_RECURSE maud_cli "${usr}/*/maud_cli.cmake")
+endif()
+
+if(WIN32)
+  set(ENV{PATH} "${usr}/bin;$ENV{PATH}")
+else()
+  set(ENV{PATH} "${usr}/bin:$ENV{PATH}")
+endif()
+set(ENV{CXX} "${CXX}")
+
+set(results "")
+foreach(scale ${SCALES})
+  math(EXPR modules "${scale} * 8")
+  set(
+    counts
+    modules=${modules}
+    partitions=2
+    implementation-units=2
+    executables=${scale}
+    tests=${scale}
+    templates=${scale}
+    options=${scale}
+    depth=3
+  )
+  set(src "${OUTPUT_DIR}/scale_${scale}")
+  set(build_dir "${src}/.build")
+  file(REMOVE_RECURSE "${src}")
+  list(TRANSFORM counts PREPEND "--" OUTPUT_VARIABLE count_args)
+  run("${SYNTHESIZE}" "${src}" ${count_args})
+  message(STATUS "scale ${scale}: ${counts}")
+
+  timed(
+    fresh_configure
+    "${CMAKE_COMMAND}" -P "${maud_cli}" --
+    "--source-dir=${src}" "--build-dir=${build_dir}" --generate-only --quiet
+  )
+
+  # Wait for maud_inject_regenerate to patch the fresh build directory, so that
+  # the builds below see the same build files as a user would.
+  foreach(attempt RANGE 200)
+    if(EXISTS "${build_dir}/CMakeFiles/VerifyGlobs.cmake")
+      file(READ "${build_dir}/CMakeFiles/VerifyGlobs.cmake" verify)
+      if(verify MATCHES "INJECTED BY MAUD")
+        break()
+      endif()
+    endif()
+    execute_process(COMMAND "${CMAKE_COMMAND}" -E sleep 0.05)
+  endforeach()
+
+  set(build_command "${CMAKE_COMMAND}" --build "${build_dir}" --config Debug)
+  timed(build ${build_command})
+  timed(no_op_build ${build_command})
+  file(GLOB_RECURSE touched "${src}/lib/*/mod_0.cxx")
+  file(TOUCH "${touched}")
+  timed(touched_rebuild ${build_command})
+  timed(reconfigure "${CMAKE_COMMAND}" "${build_dir}")
+
+  set(result "{\"scale\": ${scale}")
+  foreach(count ${counts})
+    string(REPLACE "=" "\": " count "${count}")
+    string(APPEND result ", \"${count}")
+  endforeach()
+  foreach(measurement fresh_configure build no_op_build touched_rebuild reconfigure)
+    string(APPEND result ", \"${measurement}_ms\": ${${measurement}}")
+    message(STATUS "  ${measurement}: ${${measurement}}ms")
+  endforeach()
+  list(APPEND results "${result}}")
+endforeach()
+
+list(JOIN results ",\n    " results)
+file(
+  WRITE "${OUTPUT_DIR}/results.json"
+  "{\n  \"cmake\": \"${CMAKE_VERSION}\",\n  \"results\": [\n    ${results}\n  ]\n}\n"
+)
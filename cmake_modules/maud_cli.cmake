@@ -83,7 +83,10 @@ argument(
 string(APPEND help_str "\n")
 argument(source_readonly OFF "Use symlinks to avoid writing in $source_dir")
 argument(generate_only OFF "Only generate a build directory")
+argument(fresh OFF "Configure from scratch even if the build directory is current")
 argument(CMakeLists_only OFF "Only generate CMakeLists.txt")
+argument(watch OFF "After building, rebuild whenever files change")
+argument(watch_tests OFF "Like --watch, also rerunning rebuilt test_ executables")
 
 if(log_level STREQUAL "VERBOSE")
   message(STATUS "This is Larry's spirit guide, Maud. I am looking into the box...")
@@ -103,6 +106,8 @@ cmake_path(NORMAL_PATH source_dir)
 cmake_path(ABSOLUTE_PATH build_dir)
 cmake_path(NORMAL_PATH build_dir)
 
+set(watched_dir "${source_dir}")
+
 if(source_readonly)
   cmake_path(IS_PREFIX source_dir "${build_dir}" build_in_source_dir)
   if(build_in_source_dir)
@@ -111,14 +116,16 @@ if(source_readonly)
       "Using --source-readonly requires $build_dir outside $source_dir"
     )
   endif()
-  file(WRITE "${build_dir}/CMakeLists.txt" "")
-  file(CREATE_LINK "${source_dir}" "${build_dir}/source" SYMBOLIC)
+  file(MAKE_DIRECTORY "${build_dir}")
+  if(NOT IS_SYMLINK "${build_dir}/source")
+    file(CREATE_LINK "${source_dir}" "${build_dir}/source" SYMBOLIC)
+  endif()
   set(source_dir "${build_dir}")
   set(build_dir "${build_dir}/.build")
 endif()
 
-file(
-  WRITE "${source_dir}/CMakeLists.txt"
+set(
+  lists
   "
   ${cmake_minimum}
   ${project_command}
@@ -151,44 +158,115 @@ file(
   _maud_include_directories()
 
   _maud_cxx_sources()
+  _maud_option_headers()
   _maud_setup_clang_format()
   _maud_finalize_targets()
+  _maud_module_graph()
   _maud_setup_doc()
   _maud_options_summary()
   _maud_setup_regenerate()
   "
 )
 
+set(lists_changed ON)
+if(EXISTS "${source_dir}/CMakeLists.txt")
+  file(READ "${source_dir}/CMakeLists.txt" old_lists)
+  if(old_lists STREQUAL lists)
+    set(lists_changed OFF)
+  endif()
+endif()
+if(lists_changed)
+  file(WRITE "${source_dir}/CMakeLists.txt" "${lists}")
+endif()
+
 if(CMakeLists_only)
   return()
 endif()
 
-execute_process(
-  COMMAND
-  "${CMAKE_COMMAND}"
-  -B "${build_dir}"
-  -S "${source_dir}"
-  -G "${generator}"
-  ${cmake_args}
-  --log-level=${log_level}
-  --fresh
-  RESULT_VARIABLE result
+# An existing build directory is compatible if it was generated from the same
+# CMakeLists.txt with the same generator. It can be reused without configuring
+# again if the arguments are the same too (the build tool will still regenerate if
+# any of the project's inputs changed); otherwise it is configured again with the
+# new arguments, keeping the rest of its cache.
+set(compatible OFF)
+set(reuse OFF)
+set(arguments_file "${build_dir}/_maud/cli_arguments")
+if(
+  EXISTS "${build_dir}/CMakeCache.txt"
+  AND EXISTS "${arguments_file}"
+  AND NOT lists_changed
+  AND NOT fresh
+  AND NOT generate_only
 )
+  file(STRINGS "${build_dir}/CMakeCache.txt" cached_generator REGEX "^CMAKE_GENERATOR:")
+  file(STRINGS "${build_dir}/CMakeCache.txt" cached_home REGEX "^CMAKE_HOME_DIRECTORY:")
+  file(READ "${arguments_file}" cached_args)
+  if(
+    cached_generator STREQUAL "CMAKE_GENERATOR:INTERNAL=${generator}"
+    AND cached_home STREQUAL "CMAKE_HOME_DIRECTORY:INTERNAL=${source_dir}"
+  )
+    set(compatible ON)
+    if("${cmake_args}" STREQUAL "" OR "${cmake_args}" STREQUAL "${cached_args}")
+      set(reuse ON)
+    endif()
+  endif()
+endif()
 
-if(NOT result EQUAL 0)
-  message(FATAL_ERROR "Generation failed.")
+if(reuse)
+  if(log_level STREQUAL "VERBOSE")
+    message(STATUS "Reusing build directory ${build_dir}")
+  endif()
+else()
+  if(compatible)
+    set(fresh_arg "")
+    if(log_level STREQUAL "VERBOSE")
+      message(STATUS "Reconfiguring build directory ${build_dir}")
+    endif()
+  else()
+    set(fresh_arg --fresh)
+  endif()
+  file(REMOVE "${arguments_file}")
+  execute_process(
+    COMMAND
+    "${CMAKE_COMMAND}"
+    -B "${build_dir}"
+    -S "${source_dir}"
+    -G "${generator}"
+    ${cmake_args}
+    --log-level=${log_level}
+    ${fresh_arg}
+    RESULT_VARIABLE result
+  )
+
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Generation failed.")
+  endif()
+  file(WRITE "${arguments_file}" "${cmake_args}")
 endif()
 
 if(generate_only)
   return()
 endif()
 
+# maud_inject_regenerate patches VerifyGlobs.cmake in the background just after
+# generation (after adding restat to the compile rules); wait for it (but not
+# forever, the build can regenerate without it).
 set(verify)
-while(NOT (verify MATCHES "INJECTED BY MAUD"))
+foreach(attempt RANGE 200)
+  if(reuse)
+    break()
+  endif()
   if(EXISTS "${build_dir}/CMakeFiles/VerifyGlobs.cmake")
     file(READ "${build_dir}/CMakeFiles/VerifyGlobs.cmake" verify)
+    if(verify MATCHES "INJECTED BY MAUD")
+      break()
+    endif()
   endif()
-endwhile()
+  execute_process(COMMAND "${CMAKE_COMMAND}" -E sleep 0.05)
+endforeach()
+if(NOT reuse AND NOT verify MATCHES "INJECTED BY MAUD")
+  message(WARNING "Timed out waiting for regeneration patch injection")
+endif()
 
 if(quiet AND generator MATCHES "Ninja")
   set(quiet_arg --quiet)
@@ -204,6 +282,37 @@ execute_process(
 )
 
 if(NOT result EQUAL 0)
-  message(FATAL_ERROR "Build failed.")
+  if(NOT watch AND NOT watch_tests)
+    message(FATAL_ERROR "Build failed.")
+  endif()
+  # keep watching, but report the failure in the exit code
+  message(SEND_ERROR "Build failed.")
 endif()
 
+if(NOT watch AND NOT watch_tests)
+  return()
+endif()
+
+find_program(
+  maud_watch maud_watch
+  HINTS "${CMAKE_CURRENT_LIST_DIR}/../../../bin"
+  NO_CACHE
+)
+if(NOT maud_watch)
+  message(FATAL_ERROR "Could not find maud_watch")
+endif()
+
+if(watch_tests)
+  set(tests_arg --tests)
+endif()
+
+# Only $source_dir is watched; rendered files are written by the build itself,
+# which already knows when they need to be rendered again.
+execute_process(
+  COMMAND
+  "${maud_watch}"
+  ${tests_arg}
+  "${CMAKE_COMMAND}"
+  "${build_dir}"
+  "${watched_dir}"
+)
@@ -1,3 +1,4 @@
+import json
 from pathlib import Path
 from clang.cindex import CursorKind, Index
 
@@ -295,3 +296,27 @@ def test_test_hxx():
     file_content = trike.comment_scan(path, clang_args=[])
     for directive, _, _, _ in file_content.directive_comments:
         assert directive == "c:macro"
+
+
+def test_json(tmp_path):
+    header = tmp_path / "header.hxx"
+    header.write_text("/// a macro\n#define FOO 1\n")
+    _, path = make_tu(
+        tmp_path,
+        """
+        #include "header.hxx"
+
+        /// floating
+
+        /// a function
+        int foo();
+        """,
+    )
+
+    includes = set()
+    file_content = trike.comment_scan(path, clang_args=[], includes=includes)
+    assert str(header) in includes
+
+    # Extracted content survives a round trip through JSON
+    j = json.loads(json.dumps(file_content.to_json()))
+    assert trike.FileContent.from_json(j) == file_content
@@ -1,11 +1,13 @@
 from dataclasses import dataclass
 from collections import defaultdict
+from concurrent.futures import ThreadPoolExecutor
 from contextlib import contextmanager
 from pathlib import Path
 
 import sphinx.util.logging
 import docutils.parsers.rst.directives
 import difflib
+import json
 
 from clang.cindex import (
     Cursor,
@@ -127,6 +129,44 @@ class FileContent:
     clang_diagnostics: list[str]
     mtime_when_parsed: float
 
+    def to_json(self) -> dict:
+        return {
+            "module": self.module,
+            "floating_comments": [_comment_to_json(c) for c in self.floating_comments],
+            "directive_comments": [
+                [directive, argument, namespace, _comment_to_json(comment)]
+                for directive, argument, namespace, comment in self.directive_comments
+            ],
+            "clang_diagnostics": self.clang_diagnostics,
+            "mtime_when_parsed": self.mtime_when_parsed,
+        }
+
+    @staticmethod
+    def from_json(j: dict) -> "FileContent":
+        return FileContent(
+            j["module"],
+            [_comment_from_json(c) for c in j["floating_comments"]],
+            directive_comments=[
+                (directive, argument, namespace, _comment_from_json(comment))
+                for directive, argument, namespace, comment in j["directive_comments"]
+            ],
+            clang_diagnostics=j["clang_diagnostics"],
+            mtime_when_parsed=j["mtime_when_parsed"],
+        )
+
+
+def _comment_to_json(comment: Comment) -> dict:
+    return {
+        "file": str(comment.file),
+        "next_line": comment.next_line,
+        "text": comment.text,
+        "clang_cursor_kind": comment.clang_cursor_kind,
+    }
+
+
+def _comment_from_json(j: dict) -> Comment:
+    return Comment(Path(j["file"]), j["next_line"], j["text"], j["clang_cursor_kind"])
+
 
 def is_documentable(kind: CursorKind):
     # TODO this should instead return the directive which we use
@@ -270,8 +310,16 @@ def get_documentable_declaration(
     return directive, join_tokens(declaration), cursor
 
 
-def comment_scan(path: Path, clang_args: list[str]) -> FileContent:
+def comment_scan(
+    path: Path, clang_args: list[str], includes: set[str] | None = None
+) -> FileContent:
+    """
+    Scan a file for ///. If `includes` is provided, it will be
+    filled with the files which were read during the scan.
+    """
     tu = Index.create().parse(str(path), args=clang_args, options=PARSE_FLAGS)
+    if includes is not None:
+        includes.update(i.include.name for i in tu.get_includes())
     tokens = Tokens(tu)
 
     module = ""  # TODO detect modules
@@ -412,6 +460,21 @@ class State:
         }
 
 
+def _json_manifest(app: Sphinx) -> dict[Path, Path]:
+    """
+    If /// were extracted to JSON by the build system, get the
+    mapping from each scanned file to its JSON.
+    """
+    if not app.config.trike_json_manifest:
+        return {}
+    if not hasattr(app, "_trike_json_manifest"):
+        with open(app.config.trike_json_manifest) as f:
+            app._trike_json_manifest = {
+                Path(path): Path(json_path) for path, json_path in json.load(f).items()
+            }
+    return app._trike_json_manifest
+
+
 def _env_get_outdated(
     app: Sphinx,
     env: BuildEnvironment,
@@ -424,26 +487,47 @@ def _env_get_outdated(
     if not hasattr(env, "trike_state"):
         env.trike_state = State.empty()
 
+    json_manifest = _json_manifest(app)
+    trike_files = json_manifest.keys() if json_manifest else app.config.trike_files
+
+    def mtime(path: Path) -> float:
+        # A file's JSON is rewritten whenever it or anything it includes
+        # changes, so that is what we compare against.
+        return json_manifest.get(path, path).stat().st_mtime
+
     # Even if foo.rst itself has not changed, if it referenced foo.hxx
     # which *did* change then we must consider it outdated.
     invalidated = set()
     for path in [
         path
         for path, file_content in env.trike_state.files.items()
-        if path in app.config.trike_files
-        and file_content.mtime_when_parsed == path.stat().st_mtime
+        if path in trike_files and file_content.mtime_when_parsed != mtime(path)
     ]:
         invalidated |= env.trike_state.remove(path)
 
-    for path in app.config.trike_files:
+    to_scan = []
+    for path in trike_files:
         if path in env.trike_state.files:
             # Anything outdated has already been purged
-            assert env.trike_state.files[path].mtime_when_parsed == path.stat().st_mtime
+            assert env.trike_state.files[path].mtime_when_parsed == mtime(path)
+            continue
+        if json_path := json_manifest.get(path, None):
+            with open(json_path) as f:
+                file_content = FileContent.from_json(json.load(f))
+            file_content.mtime_when_parsed = mtime(path)
+            env.trike_state.add(path, file_content)
             continue
         clang_args = app.config.trike_clang_args.get(
             path, app.config.trike_default_clang_args
         )
-        env.trike_state.add(path, comment_scan(path, clang_args))
+        to_scan.append((path, clang_args))
+
+    # libclang releases the GIL while parsing, so threads are enough to use
+    # all the jobs sphinx was given (which may have been borrowed from a jobserver).
+    with ThreadPoolExecutor(max_workers=max(app.parallel, 1)) as executor:
+        scanned = executor.map(lambda args: comment_scan(*args), to_scan)
+        for (path, _), file_content in zip(to_scan, scanned):
+            env.trike_state.add(path, file_content)
     return invalidated
 
 
@@ -552,6 +636,12 @@ def setup(app: Sphinx) -> ExtensionMetadata:
         "env",
         description="Per-file overrides of arguments which will be passed to clang",
     )
+    app.add_config_value(
+        "trike_json_manifest",
+        "",
+        "env",
+        description="A JSON object mapping files to the JSON their /// were extracted to",
+    )
     app.connect("env-get-outdated", _env_get_outdated)
     app.connect("env-merge-info", _env_merge_info)
     app.connect("env-purge-doc", _env_purge_doc)
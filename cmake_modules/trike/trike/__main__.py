@@ -0,0 +1,77 @@
+"""Extract /// from C++ sources to JSON, outside of Sphinx.
+
+    python -m trike config CONF_DIR CONFIG_JSON
+    python -m trike extract CONFIG_JSON SOURCE OUTPUT_JSON [--depfile DEPFILE]
+
+``config`` reads clang arguments from a Sphinx ``conf.py`` so that ``extract``
+can be run once per source by a build system. The JSON written by ``extract``
+can be loaded by the Sphinx extension through ``trike_json_manifest``.
+"""
+
+import argparse
+import json
+from pathlib import Path
+
+from sphinx.config import eval_config_file
+
+from . import comment_scan
+
+
+def config(conf_dir: Path, output: Path):
+    namespace = eval_config_file(str(conf_dir / "conf.py"), None)
+    output.write_text(
+        json.dumps(
+            {
+                "default_clang_args": namespace.get("trike_default_clang_args", []),
+                "clang_args": {
+                    str(path): args
+                    for path, args in namespace.get("trike_clang_args", {}).items()
+                },
+            },
+            indent=2,
+        )
+    )
+
+
+def extract(config_json: Path, source: Path, output: Path, depfile: Path | None):
+    clang_config = json.loads(config_json.read_text())
+    clang_args = clang_config["clang_args"].get(
+        str(source), clang_config["default_clang_args"]
+    )
+
+    includes = set()
+    file_content = comment_scan(source, clang_args, includes)
+    for diagnostic in file_content.clang_diagnostics:
+        print(diagnostic)
+
+    output.parent.mkdir(parents=True, exist_ok=True)
+    output.write_text(json.dumps(file_content.to_json(), indent=2))
+
+    if depfile is not None:
+        escaped = [str(p).replace(" ", "\\ ") for p in [output, source, *sorted(includes)]]
+        depfile.write_text(f"{escaped[0]}: " + " \\\n  ".join(escaped[1:]) + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(prog="python -m trike", description=__doc__)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    config_parser = commands.add_parser("config")
+    config_parser.add_argument("conf_dir", type=Path)
+    config_parser.add_argument("output", type=Path)
+
+    extract_parser = commands.add_parser("extract")
+    extract_parser.add_argument("config", type=Path)
+    extract_parser.add_argument("source", type=Path)
+    extract_parser.add_argument("output", type=Path)
+    extract_parser.add_argument("--depfile", type=Path)
+
+    args = parser.parse_args()
+    if args.command == "config":
+        config(args.conf_dir, args.output)
+    else:
+        extract(args.config, args.source, args.output, args.depfile)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,14 +1,107 @@
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <iostream>
+#include <map>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 import test_;
 import maud_;
 
 using std::operator""s;
+using std::chrono_literals::operator""min;
 
 auto const CASES = Parameter::read_file(DIR / "in2.test.yaml");
 auto const TEST_DIR = std::filesystem::path{BUILD_DIR} / "_maud/in2_tests";
+auto const TIMEOUT = 1min;
+
+// Render every case in one cmake process rather than paying for startup once per case.
+SUITE_ {
+  SuiteState() {
+    std::ostringstream manifest;
+    for (auto parameter : CASES) {
+      if (not parameter.has_child("rendered")
+          and not parameter.has_child("render error")) {
+        continue;
+      }
+      auto name = parameter.name();
+
+      auto compiled_path = TEST_DIR / name + ".in2.cmake"s;
+      write(compiled_path) << compile_in2(std::string(to_view(parameter["template"])));
+
+      manifest << (names.empty() ? "[\n  " : ",\n  ") << "{\"compiled\": ";
+      write_json_string(manifest, compiled_path.string());
+      manifest << ", \"rendered\": ";
+      write_json_string(manifest, (TEST_DIR / name).string());
+      manifest << ", \"definitions\": {";
+      if (parameter.has_child("definitions")) {
+        bool first = true;
+        for (auto definition : parameter["definitions"]) {
+          auto value = to_view(definition);
+          auto name = value.substr(0, value.find_first_of('='));
+          value = value.substr(name.size() + 1);
+          if (not std::exchange(first, false)) manifest << ", ";
+          write_json_string(manifest, name);
+          manifest << ": ";
+          write_json_string(manifest, value);
+        }
+      }
+      manifest << "}}";
+      names.push_back(name);
+    }
+    write(TEST_DIR / "manifest.json") << manifest.str() << "\n]\n";
+    write(TEST_DIR / "batch.cmake")
+        << "include(Maud)\n"
+        << "_maud_render_in2_batch(\"${MANIFEST}\" \"${STATUS}\" \"${FIRST}\")\n";
+
+    // A render error ends the batch, so resume after the failed case until done.
+    auto status_path = TEST_DIR / "status";
+    std::filesystem::remove(status_path);
+    for (size_t first = 0; first < names.size();) {
+      auto batch = spawn(
+          {
+              "cmake",
+              "-DCMAKE_MODULE_PATH=" + (DIR / "cmake_modules").string(),
+              "-DMANIFEST=" + (TEST_DIR / "manifest.json").string(),
+              "-DSTATUS=" + status_path.string(),
+              "-DFIRST=" + std::to_string(first),
+              "-P",
+              (TEST_DIR / "batch.cmake").string(),
+          },
+          TEST_DIR, Environment::current(), TIMEOUT);
+
+      std::istringstream status{std::filesystem::exists(status_path)
+                                    ? std::string(read(status_path))
+                                    : ""};
+      size_t started = names.size(), i;
+      for (std::string event; status >> event >> i;) {
+        if (event == "started") started = i;
+        if (event == "rendered") results[names[i]] = {.rendered = true};
+      }
+
+      if (batch.exit_code == 0) break;
+      if (started == names.size() or results.contains(names[started])) {
+        // the failure wasn't in any template; report it for all the remaining cases
+        for (auto const &name : names) {
+          if (not results.contains(name)) results[name] = {.error = batch.output};
+        }
+        break;
+      }
+      results[names[started]] = {.error = batch.output};
+      first = started + 1;
+    }
+  }
+
+  struct Result {
+    bool rendered = false;
+    std::string error;
+  };
+  std::vector<std::string> names;
+  std::map<std::string, Result> results;
+};
 
 TEST_(compilation, CASES) {
   auto name = parameter.name();
@@ -23,39 +116,38 @@ TEST_(compilation, CASES) {
 
 TEST_(rendering, CASES) {
   auto name = parameter.name();
-  auto in2 = to_view(parameter["template"]);
-
-  std::string definitions;
-  if (parameter.has_child("definitions")) {
-    for (auto definition : parameter["definitions"]) {
-      auto value = to_view(definition);
-      auto name = value.substr(0, value.find_first_of('='));
-      value = value.substr(name.size() + 1);
-      definitions += "set("s + name + " [======[\n"s + value + "]======])\n"s;
-    }
-  }
-  auto compiled_path = TEST_DIR / name + ".in2.cmake"s;
-  write(compiled_path) << definitions << "include(Maud)\n"
-                       << compile_in2(std::string(in2));
-
   auto rendered_path = TEST_DIR / name;
-  write(rendered_path) << "";
-
-  auto definitions_path = TEST_DIR / name + ".defs.cmake"s;
-
-  auto cmd = "cmake"s;
-  cmd += " -DRENDER_FILE=\"" + rendered_path.string() + "\"";
-  cmd += " -DCMAKE_MODULE_PATH=\"" + (DIR / "cmake_modules").string() + "\"";
-  cmd += " -P \"" + compiled_path.string() + "\"";
+  auto const &result = suite_state()->results[name];
 
   if (parameter.has_child("rendered")) {
-    if (not EXPECT_(std::system(cmd.c_str()) == 0)) return;
+    if (not(EXPECT_(result.rendered) or [&](auto &os) { os << result.error; })) return;
     EXPECT_(read(rendered_path) == to_view(parameter["rendered"]));
   }
 
   if (parameter.has_child("render error")) {
-    cmd += " 2> \"" + rendered_path.string() + "\"";
-    EXPECT_(std::system(cmd.c_str()) != 0);
-    EXPECT_(read(rendered_path) >>= ContainsRegex(to_view(parameter["render error"])));
+    EXPECT_(not result.rendered);
+    EXPECT_(result.error >>= ContainsRegex(to_view(parameter["render error"])));
+  }
+}
+
+// Rendering must not write anything but the rendered files, in particular not
+// staging files outside the build tree (batches don't define MAUD_DIR). Staging
+// files are only left beside the compiled templates which failed to render.
+TEST_(rendering_writes_only_rendered_files) {
+  auto const &names = suite_state()->names;
+  auto const &results = suite_state()->results;
+  auto failed = [&](std::string_view file) {
+    std::string_view suffix = ".in2.cmake.staging";
+    if (not file.ends_with(suffix)) return false;
+    auto result = results.find(std::string{file.substr(0, file.size() - suffix.size())});
+    return result != results.end() and not result->second.rendered;
+  };
+  for (auto const &entry : std::filesystem::directory_iterator{TEST_DIR}) {
+    auto file = entry.path().filename().string();
+    bool expected = file == "manifest.json" or file == "status" or file == "batch.cmake"
+                 or file.ends_with(".in2.cmake") or failed(file)
+                 or std::find(names.begin(), names.end(), file) != names.end();
+    if (not(EXPECT_(expected) or [&](auto &os) { os << entry.path(); })) return;
   }
+  EXPECT_(not std::filesystem::exists(TEST_DIR.root_path() / "in2_staging"));
 }
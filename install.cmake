@@ -14,6 +14,8 @@ install(
   "${dir}/cmake_modules/test_.hxx"
   "${dir}/cmake_modules/test_main_.cxx"
   "${dir}/cmake_modules/_maud_sphinx_adapter.py"
+  "${dir}/cmake_modules/_maud_jobserver.py"
+  "${dir}/cmake_modules/_maud_sphinx_build.py"
   "${dir}/cmake_modules/sphinx_requirements.txt"
   DESTINATION
   "${CMAKE_INSTALL_LIBDIR}/cmake/Maud"
@@ -0,0 +1,55 @@
+// Boost Licensed
+//
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+import executable;
+import maud_;
+
+using std::chrono_literals::operator""min;
+
+// Extract /// from a source file to the JSON which trike reads:
+//
+//   maud_apidoc SOURCE OUTPUT DEPFILE -- FALLBACK...
+//
+// If the source contains anything which might not be classified the same way
+// libclang would classify it, FALLBACK is run instead. (It is expected to write
+// OUTPUT and DEPFILE itself, as `python -m trike extract` does.)
+int main(int argc, char **argv) {
+  if (argc < 6 or argv[4] != std::string_view{"--"}) {
+    std::cerr << "Usage: " << argv[0] << " SOURCE OUTPUT DEPFILE -- FALLBACK...\n";
+    return 1;
+  }
+  std::filesystem::path source = argv[1], output = argv[2], depfile = argv[3];
+
+  auto contents = read(source);
+  if (auto file_content = extract_apidoc(source.string(), contents.c_str())) {
+    auto mtime =
+        std::chrono::file_clock::to_sys(std::filesystem::last_write_time(source));
+    file_content->mtime_when_parsed =
+        std::chrono::duration<double>(mtime.time_since_epoch()).count();
+    auto json = write(output);
+    write_json(json, *file_content);
+
+    // Nothing is read but the source itself
+    auto escape = [](std::filesystem::path const &path) {
+      std::string escaped;
+      for (char c : path.string()) {
+        if (c == ' ') escaped += '\\';
+        escaped += c;
+      }
+      return escaped;
+    };
+    write(depfile) << escape(output) << ": " << escape(source) << "\n";
+    return 0;
+  }
+
+  auto fallback = spawn({argv + 5, argv + argc}, std::filesystem::current_path(),
+                        Environment::current(), 10min);
+  std::cout << fallback.output;
+  if (fallback.timed_out) std::cout << "\n(timed out)\n";
+  return fallback.exit_code;
+}
@@ -0,0 +1,276 @@
+// Boost Licensed
+//
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+import executable;
+import maud_;
+
+namespace fs = std::filesystem;
+
+using std::chrono_literals::operator""h;
+
+constexpr std::string_view MODULE_OUTPUT = "-fmodule-output=", SUFFIX = ".maud_new",
+                           MODULE_FILE = "-fmodule-file=",
+                           PREBUILT_MODULE_PATH = "-fprebuilt-module-path=";
+
+// Redirect -fmodule-output=BMI in a single argument or a response file's contents,
+// returning the original BMI path (or "" if there was none).
+fs::path redirect_module_output(std::string &arg) {
+  auto begin = arg.find(MODULE_OUTPUT);
+  if (begin == std::string::npos) return "";
+  begin += MODULE_OUTPUT.size();
+
+  auto end = arg.find_first_of("\r\n", begin);
+  if (end == std::string::npos) end = arg.size();
+  // A quoted argument in a response file
+  auto option = begin - MODULE_OUTPUT.size();
+  if (option > 0 and arg[option - 1] == '"') --end;
+
+  fs::path bmi = arg.substr(begin, end - begin);
+  arg.insert(end, SUFFIX);
+  return bmi;
+}
+
+bool same_contents(fs::path const &a, fs::path const &b) {
+  if (not fs::exists(a) or fs::file_size(a) != fs::file_size(b)) return false;
+  return std::string_view{read(a)} == std::string_view{read(b)};
+}
+
+// The arguments of a command with the contents of response files spliced in.
+// Arguments in response files are separated by whitespace and may be quoted.
+std::vector<std::string> expand_response_files(std::vector<std::string> const &command) {
+  std::vector<std::string> args;
+  for (auto const &arg : command) {
+    if (not arg.starts_with("@")) {
+      args.push_back(arg);
+      continue;
+    }
+    auto contents = read(fs::path{arg.substr(1)});
+    std::string_view rest = contents;
+    while (true) {
+      auto begin = rest.find_first_not_of(" \t\r\n");
+      if (begin == std::string_view::npos) break;
+      rest.remove_prefix(begin);
+      auto &expanded = args.emplace_back();
+      bool quoted = false;
+      while (not rest.empty() and (quoted or rest.find_first_of(" \t\r\n") != 0)) {
+        if (rest[0] == '"') {
+          quoted = not quoted;
+        } else {
+          expanded += rest[0];
+        }
+        rest.remove_prefix(1);
+      }
+    }
+  }
+  return args;
+}
+
+// The key of a compilation in the cache, or "" if it can't be cached. Outputs don't
+// contribute to the key; the inputs which do are
+//
+// - the compiler (by path, size, and modification time)
+// - every other argument
+// - the preprocessed source
+// - the content of every BMI passed with -fmodule-file
+// - the content of every BMI in a directory passed with -fprebuilt-module-path (the
+//   modules found there aren't named on the command line)
+//
+// Preprocessing also writes the depfile (if -MD is passed), so it is current even
+// if compiling is then skipped.
+std::string cache_key(std::vector<std::string> const &command) {
+  auto args = expand_response_files(command);
+  std::error_code ec;
+  fs::path compiler = args[0];
+  auto size = fs::file_size(compiler, ec);
+  auto mtime = fs::last_write_time(compiler, ec);
+  if (ec) return "";
+
+  Sha256 key;
+  key.update("maud_compile cache 1\n");
+  key.update(compiler.string()).update("\n");
+  key.update(std::to_string(size)).update(" ");
+  key.update(std::to_string(mtime.time_since_epoch().count()));
+
+  std::vector<std::string> preprocess;
+  for (size_t i = 0; i < args.size(); ++i) {
+    std::string_view arg = args[i];
+    bool has_value = i + 1 < args.size();
+    if (arg == "-o" and has_value) {
+      ++i;
+      continue;
+    }
+    if ((arg == "-MF" or arg == "-MT" or arg == "-MQ") and has_value) {
+      preprocess.insert(preprocess.end(), {args[i], args[i + 1]});
+      ++i;
+      continue;
+    }
+    if (arg == "-c") {
+      key.update("\n-c");
+      continue;
+    }
+    if (arg.starts_with(MODULE_OUTPUT)) {
+      key.update("\n").update(MODULE_OUTPUT);
+      continue;
+    }
+    preprocess.push_back(args[i]);
+
+    if (arg.starts_with(MODULE_FILE)) {
+      // -fmodule-file=[NAME=]BMI is keyed on the BMI's content rather than its path
+      arg.remove_prefix(MODULE_FILE.size());
+      auto eq = arg.find('=');
+      fs::path bmi = arg.substr(eq + 1);
+      if (not fs::exists(bmi, ec)) return "";
+      key.update("\n").update(MODULE_FILE).update(arg.substr(0, eq + 1));
+      key.update(Sha256{}.update(read(bmi)).hex_digest());
+      continue;
+    }
+
+    if (arg.starts_with(PREBUILT_MODULE_PATH)) {
+      fs::path dir = arg.substr(PREBUILT_MODULE_PATH.size());
+      std::vector<fs::path> bmis;
+      for (auto const &entry : fs::directory_iterator{dir, ec}) {
+        if (entry.path().extension() == ".pcm") bmis.push_back(entry.path());
+      }
+      if (ec) return "";
+      std::sort(bmis.begin(), bmis.end());
+      key.update("\n").update(PREBUILT_MODULE_PATH);
+      for (auto const &bmi : bmis) {
+        key.update(" ").update(bmi.filename().string()).update("=");
+        key.update(Sha256{}.update(read(bmi)).hex_digest());
+      }
+      continue;
+    }
+    key.update("\n").update(arg);
+  }
+  preprocess.push_back("-E");
+
+  auto preprocessed = spawn(preprocess, fs::current_path(), Environment::current(), 24h);
+  if (preprocessed.exit_code != 0) return "";
+  key.update("\n").update(preprocessed.output);
+  return key.hex_digest();
+}
+
+// The path of the object file, from -o OBJECT
+fs::path object_output(std::vector<std::string> const &command) {
+  for (size_t i = 0; i + 1 < command.size(); ++i) {
+    if (command[i] == "-o") return command[i + 1];
+  }
+  return "";
+}
+
+// Outputs are copied into an entry through temporary files, so that concurrent
+// compilations never see a partial copy. The object is copied last, since an entry
+// is complete once its object exists.
+void store(fs::path const &entry, fs::path const &object, fs::path const &bmi) {
+  std::error_code ec;
+  fs::create_directories(entry, ec);
+  auto put = [&](fs::path const &output, std::string const &name) {
+    auto temporary = entry / (name + "." + std::to_string(std::random_device{}()));
+    fs::copy_file(output, temporary, fs::copy_options::overwrite_existing, ec);
+    if (not ec) fs::rename(temporary, entry / name, ec);
+    if (ec) fs::remove(temporary, ec);
+    return not ec;
+  };
+  if (not bmi.empty() and not put(bmi, "bmi")) return;
+  put(object, "object");
+}
+
+bool restore(fs::path const &entry, fs::path const &object, fs::path const &bmi) {
+  std::error_code ec;
+  if (not fs::exists(entry / "object", ec)) return false;
+  if (not bmi.empty()) {
+    fs::copy_file(entry / "bmi", bmi, fs::copy_options::overwrite_existing, ec);
+    if (ec) return false;
+  }
+  fs::copy_file(entry / "object", object, fs::copy_options::overwrite_existing, ec);
+  return not ec;
+}
+
+// Used as a CXX_COMPILER_LAUNCHER:
+//
+//   maud_compile [--cache DIR] COMPILER ARGS...
+//
+// The compiler writes its BMI to a new file, which replaces the old BMI only if
+// their content differs. Edits which don't affect a module's interface (like
+// changing a non-exported function's body) then leave its BMI untouched, and ninja
+// (whose compile rules Maud marks with restat) skips recompiling its importers.
+//
+// With --cache, the object and BMI are also stored in DIR under a key derived from
+// everything which could affect them (see cache_key). A later compilation with the
+// same key, in this or any other build directory, copies them from DIR instead of
+// compiling. Since imported BMIs are part of the key, this is safe for module units
+// (unlike caches which only consider the preprocessed source). Diagnostics are
+// not cached, so warnings are only shown when compiling.
+//
+// Currently only Clang's -fmodule-output, -fmodule-file, and -fprebuilt-module-path
+// are recognized; other compilers' commands are run unmodified.
+int main(int argc, char **argv) {
+  std::vector<std::string> command{argv + 1, argv + argc};
+  fs::path cache;
+  if (command.size() >= 2 and command[0] == "--cache") {
+    cache = command[1];
+    command.erase(command.begin(), command.begin() + 2);
+  }
+  if (command.empty()) {
+    std::cerr << "Usage: " << argv[0] << " [--cache DIR] COMPILER ARGS...\n";
+    return 1;
+  }
+
+  fs::path entry;
+  if (not cache.empty()) {
+    auto key = cache_key(command);
+    if (not key.empty()) entry = cache / key.substr(0, 2) / key;
+  }
+  auto object = object_output(command);
+
+  fs::path bmi;
+  for (auto &arg : command) {
+    if (arg.starts_with(MODULE_OUTPUT)) {
+      bmi = redirect_module_output(arg);
+      break;
+    }
+    // CMake passes -fmodule-output in the module map response file
+    if (arg.starts_with("@")) {
+      fs::path response_file = arg.substr(1);
+      std::string contents{std::string_view{read(response_file)}};
+      bmi = redirect_module_output(contents);
+      if (bmi.empty()) continue;
+      write(response_file + SUFFIX) << contents;
+      arg += SUFFIX;
+      break;
+    }
+  }
+  auto new_bmi = bmi.empty() ? bmi : bmi + SUFFIX;
+
+  int exit_code = 0;
+  if (entry.empty() or object.empty() or not restore(entry, object, new_bmi)) {
+    auto compiled = spawn(command, fs::current_path(), Environment::current(), 24h);
+    std::cout << compiled.output << std::flush;
+    exit_code = compiled.exit_code;
+    if (exit_code == 0 and not entry.empty() and not object.empty()
+        and (bmi.empty() or fs::exists(new_bmi))) {
+      store(entry, object, new_bmi);
+    }
+  }
+  if (bmi.empty()) return exit_code;
+
+  if (exit_code != 0 or not fs::exists(new_bmi)) {
+    std::error_code ec;
+    fs::remove(new_bmi, ec);
+    return exit_code;
+  }
+
+  if (same_contents(bmi, new_bmi)) {
+    fs::remove(new_bmi);
+  } else {
+    fs::rename(new_bmi, bmi);
+  }
+  return 0;
+}
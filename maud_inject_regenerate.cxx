@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cerrno>
 #include <chrono>
 #include <filesystem>
@@ -22,6 +23,40 @@ constexpr std::string_view PATCH = R"cmake(
 
 fs::path build;
 
+// Mark ninja's rules for compiling scanned sources with restat, so that when
+// maud_compile leaves a BMI untouched the units which import it aren't rebuilt.
+void add_restat(fs::path const &rules) {
+  std::string contents;
+  {
+    std::ifstream stream{rules};
+    contents.resize(stream.seekg(0, std::ios_base::end).tellg());
+    stream.seekg(0).read(contents.data(), contents.size());
+  }
+
+  bool patched = false;
+  for (auto rule = contents.find("\nrule CXX_COMPILER__"); rule != std::string::npos;
+       rule = contents.find("\nrule CXX_COMPILER__", rule + 1)) {
+    auto body = contents.find('\n', rule + 1) + 1;
+    auto end = std::min(contents.find("\n\n", body), contents.size());
+    std::string_view name{contents.data() + rule, body - rule};
+    std::string_view block{contents.data() + body, end - body};
+    if (name.find("_scanned_") == std::string_view::npos
+        or block.find("restat =") != std::string_view::npos) {
+      continue;
+    }
+    contents.insert(body, "  restat = 1\n");
+    patched = true;
+  }
+  if (not patched) return;
+
+  auto mtime = fs::last_write_time(rules);
+  fs::path patched_rules = build / "_maud" / "rules.ninja.patched";
+  std::ofstream{patched_rules} << contents;
+  fs::last_write_time(patched_rules, mtime);
+  fs::rename(patched_rules, rules);
+  fs::last_write_time(rules, mtime);
+}
+
 template <typename F>
 void exponential_backoff(F f) {
   auto delay = 50ms;
@@ -87,6 +122,14 @@ int main(int argc, char **argv) try {
   // regeneration right now, since this can lead to a chain of repeated spurious
   // regeneration.
 
+  // The maud CLI starts the build once the patched script is swapped in, so restat
+  // is added to the compile rules first (they were written before the script).
+  fs::path rules = build / "CMakeFiles" / "rules.ninja";
+  if (fs::exists(rules)) {
+    std::cout << "adding restat to compile rules" << std::endl;
+    exponential_backoff([&] { add_restat(rules); });
+  }
+
   std::cout << "reading current script" << std::endl;
   std::string contents;
   exponential_backoff([&] {
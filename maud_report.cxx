@@ -0,0 +1,61 @@
+// Boost Licensed
+//
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+import executable;
+import maud_;
+
+// Join the module graph written at configure time with compile times from a
+// .ninja_log, writing report.json and module_graph.dot to OUTPUT_DIR:
+//
+//   maud_report MODULE_GRAPH_JSON NINJA_LOG OUTPUT_DIR
+//
+// A summary of the critical path and the interfaces with the most dependents
+// is printed as well.
+int main(int argc, char **argv) {
+  if (argc != 4) {
+    std::cerr << "Usage: " << argv[0] << " MODULE_GRAPH_JSON NINJA_LOG OUTPUT_DIR\n";
+    return 1;
+  }
+  std::filesystem::path graph = argv[1], ninja_log = argv[2], output_dir = argv[3];
+  if (not std::filesystem::exists(ninja_log)) {
+    std::cerr << ninja_log.string() << " does not exist; build before reporting\n";
+    return 1;
+  }
+
+  auto graph_json = read(graph);
+  auto units = read_module_graph(graph_json.data());
+  auto log = read(ninja_log);
+  read_ninja_log(log, units);
+  auto report = analyze(units);
+
+  auto json = write(output_dir / "report.json");
+  write_json(json, units, report);
+  auto dot = write(output_dir / "module_graph.dot");
+  write_dot(dot, units, report);
+
+  std::cout << "total " << report.total_duration.count() << "ms, critical path "
+            << report.critical_duration.count() << "ms, parallelism "
+            << report.parallelism() << "\n\ncritical path:\n";
+  for (size_t i : report.critical_path) {
+    auto duration = units[i].duration.value_or(std::chrono::milliseconds{}).count();
+    std::cout << "  " << units[i].source << " (" << duration << "ms)\n";
+  }
+  std::cout << "\nmost dependents:\n";
+  for (size_t n = 0; auto const &fan_out : report.fan_out) {
+    if (n++ == 10) break;
+    std::cout << "  " << units[fan_out.unit].source << ": " << fan_out.dependents
+              << " units, " << fan_out.dependent_duration.count() << "ms\n";
+  }
+  if (not report.cyclic.empty()) {
+    std::cout << "\n" << report.cyclic.size() << " units are in import cycles\n";
+  }
+  if (not report.untimed.empty()) {
+    std::cout << "\n" << report.untimed.size() << " units had no timing in "
+              << ninja_log.string() << "\n";
+  }
+}
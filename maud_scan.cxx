@@ -1,387 +1,257 @@
 // Boost Licensed
 //
 
-#include <cassert>
-#include <cstdlib>
-#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <memory_resource>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <span>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 import executable;
 import maud_;
 
-// TODO catch errors which are definitely a problem in the interface block:
-// - unterminated string
-// - malformed comment
-// - more than a single module decl
-// - `module` followed by not-a-module-name
-// - `import` followed by not-a-module-name
-// - `module` or `import` declaration not followed by attributes then semicolon
-// - anything other than a PP directive in the global module fragment
-// - malformed attributes
-
-// FIXME skip attributes
-
-// FIXME handle header units
-
 // TODO replace <iostream> with <format>
 
-// TODO replace char const* with Location and track lines for better error reporting
-template <char... CHARS>
-constexpr auto first_of = [](auto s) {
-  while (*s != 0) {
-    bool any_matched = (... or (*s == CHARS));
-    if (any_matched) break;
-    ++s;
-  }
-  return s;
-};
-
-template <char... CHARS>
-constexpr auto first_not_of = [](auto s) {
-  while (*s != 0) {
-    bool any_matched = (... or (*s == CHARS));
-    if (not any_matched) break;
-    ++s;
-  }
-  return s;
-};
-
-void chomp_until(auto delimiter, auto &s) {
-  // NOTE: if the delimiter doesn't find anything, we'll chomp out the whole string
-  s = delimiter(s);
+// Write a make-style depfile, as compilers do with -MD -MF
+void write_depfile(std::ostream &out, std::string_view target,
+                   std::vector<std::string> const &inputs) {
+  auto escaped = [](std::string_view path) {
+    std::string e;
+    for (char c : path) {
+      if (c == ' ' or c == '#') e += '\\';
+      if (c == '$') e += '$';
+      e += c;
+    }
+    return e;
+  };
+  out << escaped(target) << ":";
+  for (auto const &input : inputs) out << " \\\n  " << escaped(input);
+  out << "\n";
 }
 
-bool try_chomp_prefix(std::string_view prefix, auto &s) {
-  auto i = s;
-  for (char c : prefix) {
-    if (c != *i++) return false;
+// Record NAME[=VALUE] from a -D as a command line macro
+void define(Macros &macros, std::string_view definition) {
+  auto eq = definition.find('=');
+  if (eq == std::string_view::npos) {
+    macros.define(definition, "1", true);
+  } else {
+    macros.define(definition.substr(0, eq), definition.substr(eq + 1), true);
   }
-  s = i;
-  return true;
 }
 
-void chomp_until_end_of_string_literal(auto &s) {
-  if (*s == 0) return;
-  assert(s[0] == '"');
-
-  if (s[-1] == 'R') {
-    ++s;
-    auto tag_begin = s;
-    chomp_until(first_of<'('>, s);
-    auto tag_end = s;
-    ++s;
-
-    while (true) {
-      chomp_until(first_of<')'>, s);
-
-      if (*s == 0) [[unlikely]] {
-        // There was no terminating "; badly formed C++ source
-        // Just bail (chomping everything)
-        return;
-      }
-
-      ++s;
-      if (memcmp(tag_begin, s, tag_end - tag_begin) == 0) {
-        s += tag_end - tag_begin;
-        if (s[0] == '"') [[likely]] {
-          ++s;
-          return;
-        }
-      }
-    }
+// Lines of an @FILE which are shared with the compiler's response file may be
+// quoted, with backslash escapes.
+std::string unquote(std::string_view quoted) {
+  std::string line;
+  for (size_t i = 0; i < quoted.size(); ++i) {
+    if (quoted[i] == '\\' and i + 1 < quoted.size()) ++i;
+    line += quoted[i];
   }
+  return line;
+}
 
-  while (true) {
-    ++s;
-    chomp_until(first_of<'"', '\\'>, s);
-
-    if (*s == 0) [[unlikely]] {
-      // There was no terminating "; badly formed C++ source
-      // Just bail (chomping everything)
-      return;
-    }
-
-    if (s[0] == '"') [[likely]] {
-      break;
-    }
-
-    ++s;
+// Compiler flags which don't change the predefined macros (force included headers are
+// assumed to be option headers, whose macros are read with --macros)
+bool is_inert(std::string_view flag) {
+  for (std::string_view prefix : {
+           "-I", "-isystem", "-iquote", "-idirafter", "-include", "-W", "-w", "-g",
+           "-MD", "-MMD", "-MF", "-MT", "-MQ", "-c", "-x", "-o", "-fmodule",
+           "-fprebuilt-module-path", "-fdiagnostics", "-fcolor-diagnostics",
+           "-fno-color-diagnostics", "-fansi-escape-codes",
+       }) {
+    if (flag.starts_with(prefix)) return true;
   }
-  assert(s[0] == '"');
-  ++s;  // the closing quote needs to be chomped
+  return false;
 }
 
-void chomp_past_unescaped_line_ending(auto &s) {
-  while (true) {
-    chomp_until(first_of<'"', '\n', '\r'>, s);
-
-    if (s[0] == '"') {
-      chomp_until_end_of_string_literal(s);
+// Scan a source for module and header unit imports, writing P1689 to DDI:
+//
+//   maud_scan [--take-undecided] [OPTION...] SOURCE DDI
+//
+// The primary output is assumed to be DDI up to its .ddi extension (DDI may have
+// another suffix, as in .ddi.new) unless --object is given.
+//
+// Preprocessing conditionals are evaluated using the macros which are known:
+//
+//   --predefined FILE  the output of `-dM -E` for one configuration; macros which
+//                      differ between configurations are unknown
+//   -DNAME[=VALUE]     a definition on the command line
+//   --macros FILE      #defines in a force included header (like an option's)
+//   -IDIR              an include directory, searched by __has_include
+//
+// The predefined macros are only used if SOURCE is compiled with no flags which
+// might change them, beyond those they were listed with:
+//
+//   --baseline-flag FLAG         a flag which the predefined macros were listed with
+//   --flags FLAG... --end-flags  the flags SOURCE is compiled with (for example
+//                                those its target adds)
+//
+// Arguments may also be read one per line (optionally quoted) from @FILE. If a module
+// or import declaration is in a group whose condition depends on anything else, no
+// DDI is written and maud_scan exits with 2 so that a compiler can scan instead.
+//
+// maud_scan also replaces the compiler's scan in the build (see CMake's
+// CMAKE_CXX_SCANDEP_SOURCE), where the DDI is collated by CMake:
+//
+//   --object OBJECT       the object file compiled from SOURCE, as primary-output
+//   --dep-file FILE       write the files which the DDI depends on to FILE
+//   --compiler-scan PATH  exit with 2 if SOURCE is PATH (for sources with
+//                         MAUD_PREPROCESSING_SCAN_OPTIONS)
+//
+// Header units and includes aren't written to such a DDI since CMake doesn't handle
+// them; Maud passes header units to their importers itself.
+int main(int argc, char **argv) {
+  std::vector<std::string> args, inputs;
+  for (std::string_view arg : std::span{argv + 1, argv + argc}) {
+    if (not arg.starts_with("@")) {
+      args.emplace_back(arg);
       continue;
     }
-
-    if (*s == 0) [[unlikely]] {
-      break;
+    inputs.emplace_back(arg.substr(1));
+    std::istringstream lines{std::string{std::string_view{read(arg.substr(1))}}};
+    for (std::string line; std::getline(lines, line);) {
+      if (line.empty()) continue;
+      if (line.size() >= 2 and line.front() == '"' and line.back() == '"') {
+        line = unquote(std::string_view{line}.substr(1, line.size() - 2));
+      }
+      args.push_back(std::move(line));
     }
-
-    bool escaped = s[-1] == '\\';
-
-    s += s[0] == '\r' and s[1] == '\n'  // check for CRLF line ending
-           ? 2
-           : 1;
-
-    if (not escaped) break;
   }
-}
 
-void chomp_past_whitespace(auto &s) {
-  chomp_until(first_not_of<' ', '\n', '\r', '\t'>, s);
-}
-
-std::string chomp_name(auto &s) {
-  auto name_begin = s;
-  chomp_until(
-      [](auto s) {
-        constexpr auto ID = [](char c) {
-          if (c >= 'a' and c <= 'z') return true;
-          if (c >= 'A' and c <= 'Z') return true;
-          if (c >= '0' and c <= '9') return true;
-          if (c == '_' or c == '.') return true;
-          return false;
-        };
-        while (*s != 0) {
-          if (not ID(*s)) break;
-          ++s;
+  Preprocessor preprocessor;
+  Macros predefined, command_line;
+  std::vector<std::filesystem::path> include_dirs, compiler_scanned;
+  std::vector<std::string> positional, flags;
+  std::set<std::string, std::less<>> baseline_flags;
+  std::string object, dep_file;
+  bool take_undecided = false, any_predefined = false;
+  for (size_t i = 0; i < args.size(); ++i) {
+    std::string_view arg = args[i];
+    bool has_value = i + 1 < args.size();
+    if (arg == "--take-undecided") {
+      take_undecided = true;
+    } else if (arg == "--object" and has_value) {
+      object = args[++i];
+    } else if (arg == "--dep-file" and has_value) {
+      dep_file = args[++i];
+    } else if (arg == "--compiler-scan" and has_value) {
+      compiler_scanned.emplace_back(args[++i]);
+    } else if (arg == "--baseline-flag" and has_value) {
+      baseline_flags.insert(args[++i]);
+    } else if (arg == "--flags") {
+      while (++i < args.size() and args[i] != "--end-flags") flags.push_back(args[i]);
+    } else if ((arg == "--predefined" or arg == "--macros") and has_value) {
+      inputs.push_back(args[++i]);
+      Macros macros;
+      macros.read_definitions(read(inputs.back()));
+      if (arg == "--macros") {
+        for (auto &[name, macro] : macros.macros) {
+          macro.command_line = true;
+          command_line.macros.insert_or_assign(name, macro);
         }
-        return s;
-      },
-      s);
-  return {name_begin, s};
-}
-
-void scan_file(std::string_view path, auto s) {
-  bool saw_export = false;
-
-  bool is_interface = false;
-  bool is_partition = false;
-  std::string logical_name, maud_module_name;
-  std::vector<std::string> requires_logical_names;
-
-  while (*s != 0) {
-    chomp_past_whitespace(s);
-    switch (s[0]) {
-      case ';':
-        ++s;
-        continue;
-
-      case '#':
-        chomp_past_unescaped_line_ending(s);
         continue;
-
-      case '/':
-        if (s[1] == '/') {
-          chomp_past_unescaped_line_ending(s);
-          continue;
-        }
-
-        if (s[1] == '*') {
-          s += 2;
-          while (true) {
-            chomp_until(first_of<'*'>, s);
-            if (s[1] == '/') break;
-            ++s;
-          }
-          continue;
-        }
-
-        // nothing else could have started with '/'
-        goto done;
-
-      case 'm':
-        if (try_chomp_prefix("module", s)) {
-          chomp_past_whitespace(s);
-          if (*s == ';') {
-            // global module fragment; nothing to extract
-            ++s;
-            continue;
-          }
-
-          // module implementation unit
-          auto name = chomp_name(s);
-
-          // is it a partition?
-          chomp_until(first_of<';', ':'>, s);
-          if (*s == ';') {
-            // not a partition
-            ++s;
-
-            maud_module_name = name;
-            if (saw_export) {
-              saw_export = false;
-              is_interface = true;
-              logical_name = std::move(name);
-            } else {
-              requires_logical_names.push_back(std::move(name));
-            }
-            continue;
-          }
-
-          // partition
-          is_partition = true;
-          ++s;
-          chomp_past_whitespace(s);
-          logical_name = name + ":" + chomp_name(s);
-          maud_module_name = std::move(name);
-
-          if (saw_export) {
-            saw_export = false;
-            is_interface = true;
-          }
-
-          chomp_until(first_of<';'>, s);
-          ++s;
-          continue;
-        }
-
-      case 'i':
-        if (try_chomp_prefix("import", s)) {
-          if (saw_export) {
-            saw_export = false;
-          }
-          chomp_past_whitespace(s);
-          if (*s == ':') {
-            ++s;
-            chomp_past_whitespace(s);
-            requires_logical_names.push_back(maud_module_name + ":" + chomp_name(s));
-          } else {
-            requires_logical_names.push_back(chomp_name(s));
-          }
-          chomp_until(first_of<';'>, s);
-          ++s;
-          continue;
-        }
-
-        // nothing else could have started with 'i'
-        goto done;
-
-      case 'e':
-        if (try_chomp_prefix("export", s)) {
-          saw_export = true;
-          continue;
-        }
-
-        // nothing else could have started with 'e'
-        goto done;
-
-      default:
-        goto done;
-    }
-  }
-
-done:
-  std::cout << "{\n";
-  std::cout << "  \"revision\": 0,\n";
-  std::cout << "  \"rules\": [\n";
-  std::cout << "    {\n";
-  std::cout << "      \"primary-output\": \"" << path << ".o\"\n";
-
-  if (is_partition or is_interface) {
-    std::cout << "      \"provides\": [\n";
-    std::cout << "        {\n";
-    std::cout << "          \"is-interface\": " << (is_interface ? "true" : "false");
-    std::cout << ",\n";
-    std::cout << "          \"logical-name\": \"" << logical_name << "\"";
-    std::cout << ",\n";
-    std::cout << "          \"source-path\": \"" << path << "\"";
-    std::cout << "\n";
-    std::cout << "        }\n";
-    std::cout << "      ]";
-
-    if (not requires_logical_names.empty()) {
-      std::cout << ",";
+      }
+      macros.reserved_are_complete = true;
+      if (std::exchange(any_predefined, true)) {
+        predefined.intersect(macros);
+      } else {
+        predefined = std::move(macros);
+      }
+    } else if (arg.starts_with("-D")) {
+      define(command_line, arg.substr(2));
+    } else if (arg.starts_with("-I")) {
+      include_dirs.emplace_back(arg.substr(2));
+    } else {
+      positional.emplace_back(arg);
     }
-    std::cout << "\n";
   }
 
-  if (not requires_logical_names.empty()) {
-    bool first = true;
-    std::cout << "      \"requires\": [\n";
-    for (auto const &name : requires_logical_names) {
-      if (not first) {
-        std::cout << ",\n";
+  // The predefined macros were listed by compiling with the baseline flags; they
+  // can only be trusted if the source isn't compiled with anything else which
+  // might change them.
+  bool predefined_apply = true;
+  for (size_t i = 0; i < flags.size(); ++i) {
+    std::string_view flag = flags[i];
+    if (baseline_flags.contains(flag)) continue;
+    if (flag.starts_with("-D")) {
+      define(command_line, flag.substr(2));
+    } else if (flag.starts_with("-U")) {
+      command_line.macros.insert_or_assign(std::string{flag.substr(2)},
+                                           Macros::Macro{Macros::UNDEFINED, "", true});
+    } else if (flag == "-fPIC" or flag == "-fpic" or flag == "-fPIE"
+               or flag == "-fpie") {
+      for (auto name : {"__PIC__", "__pic__", "__PIE__", "__pie__"}) {
+        predefined.forget(name);
       }
-      std::cout << "        {\n";
-      std::cout << "          \"logical-name\": \"" << name << "\"\n";
-      std::cout << "        }";
-      first = false;
+    } else if (flag == "-include" or flag == "-isystem" or flag == "-iquote"
+               or flag == "-idirafter" or flag == "-MF" or flag == "-MT" or flag == "-MQ"
+               or flag == "-x" or flag == "-o") {
+      ++i;
+    } else if (not is_inert(flag)) {
+      predefined_apply = false;
     }
-    std::cout << "\n";
-    std::cout << "      ]\n";
+  }
+  if (predefined_apply) preprocessor.macros = std::move(predefined);
+  for (auto &[name, macro] : command_line.macros) {
+    preprocessor.macros.macros.insert_or_assign(name, std::move(macro));
   }
 
-  std::cout << "    }\n";
-  std::cout << "  ],\n";
-  std::cout << "  \"version\": 1\n";
-  std::cout << "}\n";
-}
-
-void test_chomp_until_end_of_string_literal(char const *cases) {
-  while (*cases != 0) {
-    if (cases[0] == '#') {
-      chomp_until(first_of<'\n'>, cases);
-      ++cases;
-      continue;
-    }
-
-    auto *in_begin = cases;
-    chomp_until(first_of<';'>, cases);
-    std::string in{in_begin, cases};
-    in.resize(in.size() + 8);
-    ++cases;
-
-    auto *expected_begin = cases;
-    chomp_until(first_of<'\n'>, cases);
-    std::string expected{expected_begin, cases};
-    ++cases;
-
-    auto *data = in.c_str();
-    chomp_until(first_of<'"'>, data);
-    chomp_until_end_of_string_literal(data);
-    std::string content{in.c_str(), data};
-    if (content != expected) {
-      std::cout << "------------------------------"   //
-                << "\nfor      `" << in << "`"        //
-                << "\nexpected `" << expected << "`"  //
-                << "\nbut got  `" << content << "`" << std::endl;
-    }
+  if (positional.size() != 2) {
+    std::cerr << "Usage: " << argv[0] << " [--take-undecided] [OPTION...] SOURCE DDI\n";
+    return 1;
   }
-}
+  std::filesystem::path source = positional[0], ddi = positional[1];
 
-int main(int, char **) {
-  char const *files = std::getenv("FILES_TO_SCAN");
-  if (files) {
-    while (*files != 0) {
-      auto *c_file = files;
-      chomp_until(first_of<';'>, files);
-      std::string_view file{c_file, files};
-      if (*files != 0) {
-        ++files;
-      }
+  std::error_code ec;
+  for (auto const &path : compiler_scanned) {
+    if (std::filesystem::equivalent(source, path, ec)) return 2;
+  }
 
-      if (file.empty()) continue;
-      // TODO single-headerify and then vendor boost interprocess so that
-      // we can use a mapped file. We usually won't need the whole file in
-      // memory to read the interface block; just the first few pages should do.
-      auto contents = read(file);
-      scan_file(file, contents.c_str());
+  // A header which is found is certainly found, but one which isn't might be in an
+  // include directory which only its target adds.
+  preprocessor.has_include = [&](std::string_view header,
+                                 bool angle) -> std::optional<bool> {
+    auto found = [&](std::filesystem::path path) {
+      if (not std::filesystem::exists(path, ec)) return false;
+      inputs.push_back(path.string());
+      return true;
+    };
+    if (not angle and found(source.parent_path() / header)) return true;
+    for (auto const &dir : include_dirs) {
+      if (found(dir / header)) return true;
     }
+    return std::nullopt;
+  };
+
+  // TODO single-headerify and then vendor boost interprocess so that
+  // we can use a mapped file. We usually won't need the whole file in
+  // memory to read the interface block; just the first few pages should do.
+  auto contents = read(source);
+  auto primary_output = object;
+  if (primary_output.empty()) {
+    primary_output = ddi.string();
+    primary_output = primary_output.substr(0, primary_output.rfind(".ddi"));
+  }
+  std::pmr::monotonic_buffer_resource arena;
+  auto scanned = scan(contents.c_str(), preprocessor, &arena, take_undecided);
+  if (not scanned) return 2;
+
+  if (not dep_file.empty()) {
+    inputs.insert(inputs.begin(), source.string());
+    auto out = write(dep_file);
+    write_depfile(out, ddi.string(), inputs);
+    if (not out) return 1;
   }
 
-  auto cases = read("end_of_string_literal.cases");
-  test_chomp_until_end_of_string_literal(cases.c_str());
-
-  return 0;
+  auto out = write(ddi);
+  write_p1689(out, *scanned, source.string(), primary_output, object.empty(),
+              object.empty());
+  return out ? 0 : 1;
 }
@@ -0,0 +1,157 @@
+// Boost Licensed
+//
+#include <charconv>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+import executable;
+import maud_;
+
+namespace fs = std::filesystem;
+
+struct Counts {
+  std::map<std::string_view, int> counts{
+      {"modules", 16},    {"partitions", 2}, {"implementation-units", 2},
+      {"executables", 4}, {"tests", 4},      {"templates", 4},
+      {"options", 4},     {"depth", 2},
+  };
+
+  int operator[](std::string_view name) const { return counts.at(name); }
+};
+
+// Modules are spread over a tree of directories, DEPTH levels deep and two wide.
+fs::path module_dir(int m, int depth) {
+  fs::path dir = "lib";
+  for (int level = 0; level < depth; ++level) {
+    dir /= "d" + std::to_string((m >> level) % 2);
+  }
+  return dir;
+}
+
+std::string mod(int m) { return "mod_" + std::to_string(m); }
+
+void write_module(fs::path const &root, int m, Counts const &counts) {
+  auto dir = root / module_dir(m, counts["depth"]);
+  auto name = mod(m);
+
+  auto interface = write(dir / (name + ".cxx"));
+  interface << "export module " << name << ";\n";
+  for (int p = 0; p < counts["partitions"]; ++p) {
+    interface << "export import :part_" << p << ";\n";
+  }
+  // Each module imports up to two earlier modules, so that the module graph
+  // has both long chains and fan out.
+  if (m > 0) interface << "import " << mod(m - 1) << ";\n";
+  if (m / 2 > 0 and m / 2 != m - 1) interface << "import " << mod(m / 2) << ";\n";
+  interface << "\nexport int " << name << "()";
+  if (counts["implementation-units"] == 0) {
+    interface << " { return " << (m > 0 ? mod(m - 1) + "()" : "0") << " + 1; }\n";
+  } else {
+    interface << ";\n";
+  }
+
+  for (int p = 0; p < counts["partitions"]; ++p) {
+    auto partition = write(dir / (name + ".part_" + std::to_string(p) + ".cxx"));
+    partition << "export module " << name << ":part_" << p << ";\n\n";
+    partition << "export int " << name << "_part_" << p << "() { return " << p << "; }\n";
+  }
+
+  for (int i = 0; i < counts["implementation-units"]; ++i) {
+    auto impl = write(dir / (name + ".impl_" + std::to_string(i) + ".cxx"));
+    impl << "module " << name << ";\n\n";
+    if (i == 0) {
+      impl << "int " << name << "() { return ";
+      if (m > 0) impl << mod(m - 1) << "() + ";
+      if (counts["options"] > 0) {
+        impl << "\n#if SYNTH_OPTION_" << m % counts["options"] << "\n";
+        impl << "    1\n#else\n    2\n#endif\n    + ";
+      }
+      impl << "1; }\n";
+    } else {
+      impl << "int " << name << "_impl_" << i << "() { return " << i << "; }\n";
+    }
+  }
+}
+
+// Write a Maud project with the given number of each kind of source:
+//
+//   maud_synthesize DIR [--modules=16] [--partitions=2] [--implementation-units=2]
+//                       [--executables=4] [--tests=4] [--templates=4] [--options=4]
+//                       [--depth=2]
+//
+// Partitions and implementation units are counted per module. Options are declared
+// in options.cmake with ADD_COMPILE_DEFINITIONS and used in preprocessing
+// conditionals. The project is not otherwise interesting; it exists to measure how
+// configuring and building scale.
+int main(int argc, char **argv) {
+  Counts counts;
+  fs::path root;
+  for (std::string_view arg : std::span{argv + 1, argv + argc}) {
+    if (not arg.starts_with("--")) {
+      root = arg;
+      continue;
+    }
+    arg.remove_prefix(2);
+    auto eq = arg.find('=');
+    auto it = counts.counts.find(arg.substr(0, eq));
+    int value = -1;
+    if (eq != std::string_view::npos) {
+      std::from_chars(arg.data() + eq + 1, arg.data() + arg.size(), value);
+    }
+    if (it == counts.counts.end() or value < 0) {
+      std::cerr << "Unrecognized argument --" << arg << "\n";
+      return 1;
+    }
+    it->second = value;
+  }
+  if (root.empty()) {
+    std::cerr << "Usage: " << argv[0] << " DIR [--modules=N] [--partitions=N] ...\n";
+    return 1;
+  }
+
+  int modules = counts["modules"];
+  for (int m = 0; m < modules; ++m) write_module(root, m, counts);
+
+  auto options = write(root / "options.cmake");
+  for (int o = 0; o < counts["options"]; ++o) {
+    options << "option(SYNTH_OPTION_" << o << " \"Synthetic option " << o
+            << "\" ADD_COMPILE_DEFINITIONS)\n";
+  }
+
+  for (int t = 0; t < counts["templates"]; ++t) {
+    auto name = "gen_" + std::to_string(t);
+    auto in2 = write(root / "gen" / (name + ".cxx.in2"));
+    in2 << "export module " << name << ";\n\n";
+    in2 << "export int " << name << "() { return 0@\n";
+    in2 << "  foreach(i RANGE " << t << ")\n";
+    in2 << "    render(\" + ${i}\")\n";
+    in2 << "  endforeach()\n";
+    in2 << "@; }\n";
+  }
+
+  for (int e = 0; e < counts["executables"]; ++e) {
+    auto exe = write(root / "bin" / ("exe_" + std::to_string(e) + ".cxx"));
+    exe << "import executable;\n";
+    if (modules > 0) exe << "import " << mod(e % modules) << ";\n";
+    if (counts["templates"] > 0) {
+      exe << "import gen_" << e % counts["templates"] << ";\n";
+    }
+    exe << "\nint main() { return ";
+    if (modules > 0) exe << mod(e % modules) << "() + ";
+    if (counts["templates"] > 0) exe << "gen_" << e % counts["templates"] << "() + ";
+    exe << "0; }\n";
+  }
+
+  for (int t = 0; t < counts["tests"]; ++t) {
+    auto test = write(root / "test" / ("suite_" + std::to_string(t) + ".test.cxx"));
+    test << "import test_;\n";
+    if (modules > 0) test << "import " << mod(t % modules) << ";\n";
+    test << "\nTEST_(positive) { EXPECT_(";
+    if (modules > 0) test << mod(t % modules) << "() + ";
+    test << "1 > 0); }\n";
+  }
+  return 0;
+}
@@ -0,0 +1,63 @@
+// Boost Licensed
+//
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+import executable;
+import maud_;
+
+namespace fs = std::filesystem;
+
+using std::chrono_literals::operator""ms;
+using std::chrono_literals::operator""h;
+
+// Rebuild whenever watched files change:
+//
+//   maud_watch [--tests] CMAKE_COMMAND BUILD_DIR WATCHED_DIR...
+//
+// A burst of changes (saving several files, a branch checkout) is waited out
+// before building. The build itself regenerates if files were added or imports
+// changed, just as any other build of a Maud project does. With --tests, each
+// test_ executable which was relinked by the build is run. The output of builds and
+// tests goes straight to this process's stdout and stderr as they run.
+int main(int argc, char **argv) {
+  std::vector<std::string> args{argv + 1, argv + argc};
+  bool run_tests = not args.empty() and args.front() == "--tests";
+  if (run_tests) args.erase(args.begin());
+  if (args.size() < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--tests] CMAKE_COMMAND BUILD_DIR WATCHED_DIR...\n";
+    return 1;
+  }
+  std::string cmake = args[0];
+  auto build_dir = fs::absolute(args[1]).lexically_normal();
+  Watcher watcher{{args.begin() + 2, args.end()}, build_dir};
+
+  constexpr auto DEBOUNCE = 100ms;
+  while (true) {
+    std::cout << "\nwatching for changes..." << std::endl;
+    while (not watcher.wait(1h)) {
+    }
+    while (watcher.wait(DEBOUNCE)) {
+    }
+
+    auto tests_before = test_executables(build_dir);
+    if (run_attached({cmake, "--build", build_dir.string()}, build_dir) != 0) {
+      std::cout << "build failed" << std::endl;
+      continue;
+    }
+    if (not run_tests) continue;
+
+    for (auto const &[test, mtime] : test_executables(build_dir)) {
+      auto before = tests_before.find(test);
+      if (before != tests_before.end() and before->second == mtime) continue;
+
+      std::cout << "running " << test.string() << std::endl;
+      int exit_code = run_attached({test.string()}, build_dir);
+      std::cout << test.filename().string() << (exit_code == 0 ? " passed" : " FAILED")
+                << std::endl;
+    }
+  }
+}
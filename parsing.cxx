@@ -1,8 +1,13 @@
 // Boost Licensed
 //
 module;
+#include <cassert>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
 #include <string>
+#include <string_view>
 export module maud_:parsing;
 
 template <bool INVERT, char... CHARS>
@@ -66,3 +71,158 @@ export struct Location {
 
   bool operator==(Location const &) const = default;
 };
+
+// TODO replace char const* with Location and track lines for better error reporting
+export template <char... CHARS>
+constexpr auto first_of = [](auto s) {
+  while (*s != 0) {
+    bool any_matched = (... or (*s == CHARS));
+    if (any_matched) break;
+    ++s;
+  }
+  return s;
+};
+
+export template <char... CHARS>
+constexpr auto first_not_of = [](auto s) {
+  while (*s != 0) {
+    bool any_matched = (... or (*s == CHARS));
+    if (not any_matched) break;
+    ++s;
+  }
+  return s;
+};
+
+export void chomp_until(auto delimiter, auto &s) {
+  // NOTE: if the delimiter doesn't find anything, we'll chomp out the whole string
+  s = delimiter(s);
+}
+
+export bool try_chomp_prefix(std::string_view prefix, auto &s) {
+  auto i = s;
+  for (char c : prefix) {
+    if (c != *i++) return false;
+  }
+  s = i;
+  return true;
+}
+
+export void chomp_until_end_of_string_literal(auto &s) {
+  if (*s == 0) return;
+  assert(s[0] == '"');
+
+  if (s[-1] == 'R') {
+    ++s;
+    auto tag_begin = s;
+    chomp_until(first_of<'('>, s);
+    auto tag_end = s;
+    ++s;
+
+    while (true) {
+      chomp_until(first_of<')'>, s);
+
+      if (*s == 0) [[unlikely]] {
+        // There was no terminating "; badly formed C++ source
+        // Just bail (chomping everything)
+        return;
+      }
+
+      ++s;
+      if (memcmp(tag_begin, s, tag_end - tag_begin) == 0) {
+        s += tag_end - tag_begin;
+        if (s[0] == '"') [[likely]] {
+          ++s;
+          return;
+        }
+      }
+    }
+  }
+
+  while (true) {
+    ++s;
+    chomp_until(first_of<'"', '\\'>, s);
+
+    if (*s == 0) [[unlikely]] {
+      // There was no terminating "; badly formed C++ source
+      // Just bail (chomping everything)
+      return;
+    }
+
+    if (s[0] == '"') [[likely]] {
+      break;
+    }
+
+    ++s;
+  }
+  assert(s[0] == '"');
+  ++s;  // the closing quote needs to be chomped
+}
+
+export void chomp_past_unescaped_line_ending(auto &s) {
+  while (true) {
+    chomp_until(first_of<'"', '\n', '\r'>, s);
+
+    if (s[0] == '"') {
+      chomp_until_end_of_string_literal(s);
+      continue;
+    }
+
+    if (*s == 0) [[unlikely]] {
+      break;
+    }
+
+    bool escaped = s[-1] == '\\';
+
+    s += s[0] == '\r' and s[1] == '\n'  // check for CRLF line ending
+           ? 2
+           : 1;
+
+    if (not escaped) break;
+  }
+}
+
+export void chomp_past_whitespace(auto &s) {
+  chomp_until(first_not_of<' ', '\n', '\r', '\t'>, s);
+}
+
+export std::string_view chomp_name(auto &s) {
+  auto name_begin = s;
+  chomp_until(
+      [](auto s) {
+        constexpr auto ID = [](char c) {
+          if (c >= 'a' and c <= 'z') return true;
+          if (c >= 'A' and c <= 'Z') return true;
+          if (c >= '0' and c <= '9') return true;
+          if (c == '_' or c == '.') return true;
+          return false;
+        };
+        while (*s != 0) {
+          if (not ID(*s)) break;
+          ++s;
+        }
+        return s;
+      },
+      s);
+  return {name_begin, s};
+}
+
+// Write str as a JSON string literal
+export void write_json_string(std::ostream &os, std::string_view str) {
+  os << '"';
+  for (char c : str) {
+    if (c == '"' or c == '\\') {
+      os << '\\' << c;
+    } else if (c == '\n') {
+      os << "\\n";
+    } else if (c == '\t') {
+      os << "\\t";
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[7];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      os << escaped;
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
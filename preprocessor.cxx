@@ -0,0 +1,653 @@
+// Boost Licensed
+//
+module;
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+export module maud_:preprocessor;
+
+// What is known about the macros visible to a source file while it is scanned.
+// Anything which isn't known is UNKNOWN, so that conditions which depend on it are
+// left for a compiler to decide.
+export struct Macros {
+  enum State { UNKNOWN, UNDEFINED, DEFINED };
+
+  struct Macro {
+    State state;
+    std::string value;
+    // Defined on the command line or by a force included header (like an option's),
+    // which a system header is assumed not to redefine
+    bool command_line = false;
+    bool operator==(Macro const &) const = default;
+  };
+  std::map<std::string, Macro, std::less<>> macros;
+
+  // Whether reserved identifiers (like __clang__) which aren't in macros are known
+  // to be undefined. This holds when macros were read from the compiler's list of
+  // predefined macros, until anything is #included.
+  bool reserved_are_complete = false;
+
+  void define(std::string_view name, std::string_view value, bool command_line = false) {
+    macros.insert_or_assign(std::string{name},
+                            Macro{DEFINED, std::string{value}, command_line});
+  }
+  void undefine(std::string_view name) {
+    macros.insert_or_assign(std::string{name}, Macro{UNDEFINED, ""});
+  }
+  void forget(std::string_view name) {
+    macros.insert_or_assign(std::string{name}, Macro{UNKNOWN, ""});
+  }
+
+  // Record the `#define NAME VALUE` lines in source, ignoring everything else.
+  // Function-like macros are recorded as UNKNOWN since they are never expanded.
+  void read_definitions(std::string_view source);
+
+  // Keep only the definitions which other agrees with.
+  void intersect(Macros const &other);
+
+  // An #include might define or undefine anything (for example <version> defines
+  // the __cpp_lib_* feature test macros), except the macros which the standard
+  // predefines and forbids redefining. A system header is also assumed to leave
+  // command line macros alone.
+  void include(bool system);
+
+  std::pair<State, std::string_view> lookup(std::string_view name) const;
+};
+
+// Whether a header can be found, or nullopt if that can't be known.
+export using HasInclude =
+    std::function<std::optional<bool>(std::string_view header, bool angle)>;
+
+// Evaluate the controlling expression of an #if or #elif, or return nullopt if its
+// value depends on something unknown (or if it is malformed; a compiler will
+// diagnose that).
+export std::optional<intmax_t> evaluate(std::string_view expression, Macros const &macros,
+                                        HasInclude const &has_include);
+
+// Track preprocessing directives while scanning a source file, to decide which
+// groups of #if/#elif/#else are skipped.
+export struct Preprocessor {
+  enum State { TAKEN, SKIPPED, UNDECIDED };
+
+  Macros macros;
+  HasInclude has_include = [](std::string_view, bool) { return std::nullopt; };
+
+  struct Group {
+    State state;
+    // Whether an earlier branch of this conditional was certainly/possibly taken
+    bool taken, maybe_taken;
+  };
+  std::vector<Group> groups;
+
+  // The state of the innermost group, taking all enclosing groups into account
+  State state() const {
+    State s = TAKEN;
+    for (auto const &group : groups) {
+      if (group.state == SKIPPED) return SKIPPED;
+      if (group.state == UNDECIDED) s = UNDECIDED;
+    }
+    return s;
+  }
+
+  // Handle a directive, given the text of its logical line after the `#`.
+  // Returns false if the directive is malformed (like an #endif without an #if).
+  bool directive(std::string_view line);
+
+  std::optional<bool> condition(std::string_view name, std::string_view rest) const;
+};
+
+bool is_identifier_start(char c) {
+  return std::isalpha(static_cast<unsigned char>(c)) or c == '_';
+}
+bool is_identifier(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) or c == '_';
+}
+
+std::string_view trim(std::string_view s) {
+  while (not s.empty() and std::isspace(static_cast<unsigned char>(s.front()))) {
+    s.remove_prefix(1);
+  }
+  while (not s.empty() and std::isspace(static_cast<unsigned char>(s.back()))) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+std::string_view chomp_identifier(std::string_view &s) {
+  s = trim(s);
+  size_t end = 0;
+  if (not s.empty() and is_identifier_start(s[0])) {
+    while (end < s.size() and is_identifier(s[end])) ++end;
+  }
+  auto identifier = s.substr(0, end);
+  s.remove_prefix(end);
+  return identifier;
+}
+
+// Reserved identifiers which compilers define without listing them as predefined
+bool is_builtin(std::string_view name) {
+  for (std::string_view builtin : {
+           "__FILE__",
+           "__LINE__",
+           "__DATE__",
+           "__TIME__",
+           "__TIMESTAMP__",
+           "__COUNTER__",
+           "__INCLUDE_LEVEL__",
+           "__BASE_FILE__",
+           "__FILE_NAME__",
+           "__VA_ARGS__",
+           "__VA_OPT__",
+       }) {
+    if (name == builtin) return true;
+  }
+  return name.starts_with("__has_") or name.starts_with("__is_")
+      or name.starts_with("__building_module");
+}
+
+bool is_reserved(std::string_view name) {
+  if (name.size() < 2 or name[0] != '_') return false;
+  return name[1] == '_' or std::isupper(static_cast<unsigned char>(name[1]));
+}
+
+void Macros::read_definitions(std::string_view source) {
+  while (not source.empty()) {
+    auto line = source.substr(0, source.find('\n'));
+    source.remove_prefix(std::min(source.size(), line.size() + 1));
+
+    line = trim(line);
+    if (not line.starts_with("#")) continue;
+    line = trim(line.substr(1));
+    if (not line.starts_with("define")) continue;
+    line.remove_prefix(6);
+
+    auto name = chomp_identifier(line);
+    if (name.empty()) continue;
+    if (line.starts_with("(")) {
+      forget(name);
+    } else {
+      define(name, trim(line));
+    }
+  }
+}
+
+void Macros::intersect(Macros const &other) {
+  for (auto &[name, macro] : macros) {
+    auto [state, value] = other.lookup(name);
+    if (state != macro.state or value != macro.value) macro = {UNKNOWN, ""};
+  }
+  for (auto const &[name, macro] : other.macros) {
+    if (not macros.contains(name)) forget(name);
+  }
+  reserved_are_complete = reserved_are_complete and other.reserved_are_complete;
+}
+
+// Macros which [cpp.predefined] forbids a #define or #undef of
+bool is_standard_predefined(std::string_view name) {
+  return name == "__cplusplus" or name.starts_with("__STDC")
+      or (name.starts_with("__cpp_") and not name.starts_with("__cpp_lib_"));
+}
+
+void Macros::include(bool system) {
+  for (auto &[name, macro] : macros) {
+    if (is_standard_predefined(name)) continue;
+    if (system and macro.command_line) continue;
+    macro = {UNKNOWN, ""};
+  }
+  reserved_are_complete = false;
+}
+
+std::pair<Macros::State, std::string_view> Macros::lookup(std::string_view name) const {
+  if (name == "__has_include") return {DEFINED, ""};
+  if (auto it = macros.find(name); it != macros.end()) {
+    return {it->second.state, it->second.value};
+  }
+  if (reserved_are_complete and is_reserved(name) and not is_builtin(name)) {
+    return {UNDEFINED, ""};
+  }
+  return {UNKNOWN, ""};
+}
+
+struct Token {
+  enum Kind { NUMBER, IDENTIFIER, PUNCTUATOR, HAS_INCLUDE, UNKNOWN } kind;
+  std::string_view text;
+  intmax_t value = 0;
+
+  bool is(std::string_view punctuator) const {
+    return kind == PUNCTUATOR and text == punctuator;
+  }
+};
+
+std::optional<intmax_t> parse_integer(std::string_view s) {
+  int base = 10;
+  if (s.starts_with("0x") or s.starts_with("0X")) {
+    base = 16;
+    s.remove_prefix(2);
+  } else if (s.starts_with("0b") or s.starts_with("0B")) {
+    base = 2;
+    s.remove_prefix(2);
+  } else if (s.starts_with("0")) {
+    base = 8;
+  }
+
+  intmax_t value = 0;
+  bool any_digits = false;
+  while (not s.empty()) {
+    char c = s[0];
+    int digit = c >= '0' and c <= '9' ? c - '0'
+              : c >= 'a' and c <= 'f' ? c - 'a' + 10
+              : c >= 'A' and c <= 'F' ? c - 'A' + 10
+                                      : 99;
+    if (c == '\'') {
+      s.remove_prefix(1);
+      continue;
+    }
+    if (digit >= base) break;
+    value = value * base + digit;
+    any_digits = true;
+    s.remove_prefix(1);
+  }
+  // Only integer suffixes may follow
+  for (char c : s) {
+    if (c != 'u' and c != 'U' and c != 'l' and c != 'L') return std::nullopt;
+  }
+  if (not any_digits and base != 8) return std::nullopt;
+  return value;
+}
+
+std::optional<std::vector<Token>> lex(std::string_view s) {
+  std::vector<Token> tokens;
+  while (not(s = trim(s)).empty()) {
+    if (std::isdigit(static_cast<unsigned char>(s[0]))) {
+      size_t end = 0;
+      while (end < s.size() and (is_identifier(s[end]) or s[end] == '\'')) ++end;
+      auto value = parse_integer(s.substr(0, end));
+      if (not value) return std::nullopt;
+      tokens.push_back({Token::NUMBER, s.substr(0, end), *value});
+      s.remove_prefix(end);
+      continue;
+    }
+
+    if (is_identifier_start(s[0])) {
+      auto name = chomp_identifier(s);
+      if (name == "__has_include" and trim(s).starts_with("(")) {
+        // __has_include(<header>) or __has_include("header"); the header-name
+        // isn't made of ordinary tokens.
+        s = trim(trim(s).substr(1));
+        if (s.empty() or (s[0] != '<' and s[0] != '"')) return std::nullopt;
+        bool angle = s[0] == '<';
+        auto end = s.find(angle ? '>' : '"', 1);
+        if (end == std::string_view::npos) return std::nullopt;
+        tokens.push_back({Token::HAS_INCLUDE, s.substr(1, end - 1), angle});
+        s = trim(s.substr(end + 1));
+        if (not s.starts_with(")")) return std::nullopt;
+        s.remove_prefix(1);
+        continue;
+      }
+
+      // Alternative tokens are operators, even in preprocessing directives
+      Token token{Token::IDENTIFIER, name};
+      for (auto [alternative, punctuator] : {
+               std::pair{"and", "&&"},
+               {"or", "||"},
+               {"not", "!"},
+               {"not_eq", "!="},
+               {"bitand", "&"},
+               {"bitor", "|"},
+               {"xor", "^"},
+               {"compl", "~"},
+           }) {
+        if (name == alternative) token = {Token::PUNCTUATOR, punctuator};
+      }
+      tokens.push_back(token);
+      continue;
+    }
+
+    bool matched = false;
+    for (std::string_view punctuator : {
+             "<<", ">>", "<=", ">=", "==", "!=", "&&", "||", "(", ")", "!", "~", "*",
+             "/", "%", "+", "-", "<", ">", "&", "^", "|", "?", ":", ",",
+         }) {
+      if (s.starts_with(punctuator)) {
+        tokens.push_back({Token::PUNCTUATOR, punctuator});
+        s.remove_prefix(punctuator.size());
+        matched = true;
+        break;
+      }
+    }
+    // Character and string literals, among other things, aren't handled
+    if (not matched) return std::nullopt;
+  }
+  return tokens;
+}
+
+struct Expander {
+  Macros const &macros;
+  HasInclude const &has_include;
+  std::vector<Token> out;
+
+  // Replace macros by their definitions and `defined` or `__has_include` by their
+  // values. Anything which can't be known is replaced by an UNKNOWN token.
+  bool expand(std::vector<Token> const &tokens, int depth) {
+    // Recursive macros are left unexpanded, which can't be evaluated anyway
+    if (depth > 64) return false;
+
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      auto const &token = tokens[i];
+      bool call = i + 1 < tokens.size() and tokens[i + 1].is("(");
+
+      if (token.kind == Token::HAS_INCLUDE) {
+        auto found = has_include(token.text, token.value != 0);
+        if (found) {
+          out.push_back({Token::NUMBER, token.text, *found});
+        } else {
+          out.push_back({Token::UNKNOWN, token.text});
+        }
+        continue;
+      }
+
+      if (token.kind != Token::IDENTIFIER) {
+        out.push_back(token);
+        continue;
+      }
+
+      if (token.text == "defined") {
+        bool parenthesized = call;
+        if (parenthesized) ++i;
+        if (++i == tokens.size() or tokens[i].kind != Token::IDENTIFIER) return false;
+        auto state = macros.lookup(tokens[i].text).first;
+        if (parenthesized and (++i == tokens.size() or not tokens[i].is(")"))) {
+          return false;
+        }
+
+        if (state == Macros::UNKNOWN) {
+          out.push_back({Token::UNKNOWN, token.text});
+        } else {
+          out.push_back({Token::NUMBER, token.text, state == Macros::DEFINED});
+        }
+        continue;
+      }
+
+      if (token.text == "true" or token.text == "false") {
+        out.push_back({Token::NUMBER, token.text, token.text == "true"});
+        continue;
+      }
+
+      auto [state, value] = macros.lookup(token.text);
+      if (state == Macros::DEFINED) {
+        auto definition = lex(value);
+        if (not definition or not expand(*definition, depth + 1)) return false;
+        continue;
+      }
+
+      if (state == Macros::UNDEFINED) {
+        // An undefined identifier is replaced by 0, which can't be called
+        if (call) return false;
+        out.push_back({Token::NUMBER, token.text, 0});
+        continue;
+      }
+
+      out.push_back({Token::UNKNOWN, token.text});
+      if (call) {
+        // Skip the arguments of an unknown function-like macro
+        for (int parens = 0; ++i < tokens.size();) {
+          if (tokens[i].is("(")) ++parens;
+          if (tokens[i].is(")") and --parens == 0) break;
+        }
+        if (i == tokens.size()) return false;
+      }
+    }
+    return true;
+  }
+};
+
+int precedence(Token const &token) {
+  if (token.kind != Token::PUNCTUATOR) return -1;
+  auto op = token.text;
+  if (op == "*" or op == "/" or op == "%") return 10;
+  if (op == "+" or op == "-") return 9;
+  if (op == "<<" or op == ">>") return 8;
+  if (op == "<" or op == "<=" or op == ">" or op == ">=") return 7;
+  if (op == "==" or op == "!=") return 6;
+  if (op == "&") return 5;
+  if (op == "^") return 4;
+  if (op == "|") return 3;
+  if (op == "&&") return 2;
+  if (op == "||") return 1;
+  return -1;
+}
+
+// Values are nullopt when unknown. An unknown operand doesn't necessarily make the
+// whole expression unknown, for example `0 && UNKNOWN` is still 0.
+using Value = std::optional<intmax_t>;
+
+Value apply(std::string_view op, Value l, Value r) {
+  if (op == "&&") {
+    if ((l and *l == 0) or (r and *r == 0)) return 0;
+    if (l and r) return 1;
+    return std::nullopt;
+  }
+  if (op == "||") {
+    if ((l and *l != 0) or (r and *r != 0)) return 1;
+    if (l and r) return 0;
+    return std::nullopt;
+  }
+  if (not l or not r) return std::nullopt;
+
+  intmax_t a = *l, b = *r;
+  if (op == "*") return a * b;
+  if (op == "/") return b == 0 ? Value{} : a / b;
+  if (op == "%") return b == 0 ? Value{} : a % b;
+  if (op == "+") return a + b;
+  if (op == "-") return a - b;
+  if (op == "<<") return b < 0 or b >= 63 ? Value{} : a << b;
+  if (op == ">>") return b < 0 or b >= 63 ? Value{} : a >> b;
+  if (op == "<") return a < b;
+  if (op == "<=") return a <= b;
+  if (op == ">") return a > b;
+  if (op == ">=") return a >= b;
+  if (op == "==") return a == b;
+  if (op == "!=") return a != b;
+  if (op == "&") return a & b;
+  if (op == "^") return a ^ b;
+  if (op == "|") return a | b;
+  return std::nullopt;
+}
+
+struct Parser {
+  std::vector<Token> const &tokens;
+  size_t i = 0;
+  bool failed = false;
+
+  bool next_is(std::string_view punctuator) const {
+    return i < tokens.size() and tokens[i].is(punctuator);
+  }
+
+  Value primary() {
+    if (i == tokens.size()) {
+      failed = true;
+      return std::nullopt;
+    }
+    auto const &token = tokens[i++];
+    if (token.kind == Token::NUMBER) return token.value;
+    if (token.kind == Token::UNKNOWN) return std::nullopt;
+
+    if (token.is("(")) {
+      auto value = conditional();
+      if (not next_is(")")) failed = true;
+      ++i;
+      return value;
+    }
+
+    if (token.is("!") or token.is("~") or token.is("-") or token.is("+")) {
+      auto operand = primary();
+      if (not operand) return std::nullopt;
+      if (token.is("!")) return *operand == 0;
+      if (token.is("~")) return ~*operand;
+      if (token.is("-")) return -*operand;
+      return *operand;
+    }
+
+    failed = true;
+    return std::nullopt;
+  }
+
+  Value binary(int min_precedence) {
+    auto l = primary();
+    while (i < tokens.size()) {
+      int p = precedence(tokens[i]);
+      if (p < min_precedence) break;
+      auto op = tokens[i++].text;
+      l = apply(op, l, binary(p + 1));
+    }
+    return l;
+  }
+
+  Value conditional() {
+    auto condition = binary(1);
+    if (not next_is("?")) return condition;
+    ++i;
+    auto t = conditional();
+    if (not next_is(":")) {
+      failed = true;
+      return std::nullopt;
+    }
+    ++i;
+    auto f = conditional();
+    if (not condition) return t == f ? t : std::nullopt;
+    return *condition != 0 ? t : f;
+  }
+};
+
+std::optional<intmax_t> evaluate(std::string_view expression, Macros const &macros,
+                                 HasInclude const &has_include) {
+  auto tokens = lex(expression);
+  if (not tokens) return std::nullopt;
+
+  Expander expander{macros, has_include, {}};
+  if (not expander.expand(*tokens, 0)) return std::nullopt;
+
+  Parser parser{expander.out};
+  auto value = parser.conditional();
+  if (parser.failed or parser.i != parser.tokens.size()) return std::nullopt;
+  return value;
+}
+
+std::optional<bool> Preprocessor::condition(std::string_view name,
+                                            std::string_view rest) const {
+  if (name == "ifdef" or name == "ifndef" or name == "elifdef" or name == "elifndef") {
+    auto identifier = chomp_identifier(rest);
+    if (identifier.empty() or not trim(rest).empty()) return std::nullopt;
+    auto state = macros.lookup(identifier).first;
+    if (state == Macros::UNKNOWN) return std::nullopt;
+    return (state == Macros::DEFINED) == (name == "ifdef" or name == "elifdef");
+  }
+  if (auto value = evaluate(rest, macros, has_include)) return *value != 0;
+  return std::nullopt;
+}
+
+// Remove comments and line continuations from a directive
+std::string clean_directive(std::string_view line) {
+  std::string cleaned;
+  for (size_t i = 0; i < line.size(); ++i) {
+    if (line[i] == '\\' and (line.substr(i + 1).starts_with("\n")
+                             or line.substr(i + 1).starts_with("\r\n"))) {
+      i = line.find('\n', i);
+      cleaned += ' ';
+      continue;
+    }
+    if (line.substr(i).starts_with("//")) break;
+    if (line.substr(i).starts_with("/*")) {
+      i = std::min(line.find("*/", i + 2), line.size()) + 1;
+      cleaned += ' ';
+      continue;
+    }
+    if (line[i] == '"' or line[i] == '\'') {
+      // Don't look for comments in literals, as in #include "a//b.h"
+      auto end = line.find(line[i], i + 1);
+      if (end == std::string_view::npos) end = line.size() - 1;
+      cleaned += line.substr(i, end - i + 1);
+      i = end;
+      continue;
+    }
+    cleaned += line[i];
+  }
+  return cleaned;
+}
+
+bool Preprocessor::directive(std::string_view line) {
+  auto cleaned = clean_directive(line);
+  std::string_view rest = cleaned;
+  auto name = chomp_identifier(rest);
+
+  if (name == "if" or name == "ifdef" or name == "ifndef") {
+    if (state() == SKIPPED) {
+      // Conditions in a skipped group are never evaluated
+      groups.push_back({SKIPPED, true, true});
+      return true;
+    }
+    auto c = condition(name, rest);
+    groups.push_back({
+        not c ? UNDECIDED : *c ? TAKEN : SKIPPED,
+        c == true,
+        c != false,
+    });
+    return true;
+  }
+
+  if (name == "elif" or name == "elifdef" or name == "elifndef" or name == "else") {
+    if (groups.empty()) return false;
+    auto &group = groups.back();
+    if (group.taken) {
+      group.state = SKIPPED;
+      return true;
+    }
+    auto c = name == "else" ? std::optional{true} : condition(name, rest);
+    if (c == false) {
+      group.state = SKIPPED;
+    } else if (c == true) {
+      group.state = group.maybe_taken ? UNDECIDED : TAKEN;
+      // Either this or an earlier (undecided) branch is taken, so no later one is
+      group.taken = true;
+    } else {
+      group.state = UNDECIDED;
+    }
+    group.maybe_taken = group.maybe_taken or c != false;
+    return true;
+  }
+
+  if (name == "endif") {
+    if (groups.empty()) return false;
+    groups.pop_back();
+    return true;
+  }
+
+  auto s = state();
+  if (s == SKIPPED) return true;
+
+  if (name == "define" or name == "undef") {
+    auto macro = chomp_identifier(rest);
+    if (macro.empty()) return false;
+    if (s == UNDECIDED or rest.starts_with("(")) {
+      // Might or might not be defined, or function-like
+      macros.forget(macro);
+    } else if (name == "define") {
+      macros.define(macro, trim(rest));
+    } else {
+      macros.undefine(macro);
+    }
+    return true;
+  }
+
+  if (name == "include" or name == "include_next" or name == "import") {
+    macros.include(trim(rest).starts_with("<"));
+  }
+  return true;
+}
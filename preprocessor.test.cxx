@@ -0,0 +1,145 @@
+#include <cstdint>
+#include <optional>
+#include <string_view>
+import test_;
+import maud_;
+
+Macros predefined() {
+  Macros macros;
+  macros.read_definitions(R"(
+    #define __clang__ 1
+    #define __cplusplus 202002L
+    #define __STDC_HOSTED__ 1
+    #define __has_feature_stub(x) 0
+  )");
+  macros.reserved_are_complete = true;
+  macros.define("FOO_ENABLED", "1");
+  macros.define("FOO_LEVEL_HI", "0");
+  macros.define("VERSION", "(FOO_ENABLED + 2)");
+  return macros;
+}
+
+std::optional<intmax_t> eval(std::string_view expression) {
+  return evaluate(expression, predefined(), [](std::string_view header, bool angle) {
+    return angle and header == "vector" ? std::optional{true} : std::nullopt;
+  });
+}
+
+TEST_(expressions) {
+  EXPECT_(eval("1 + 2 * 3") == 7);
+  EXPECT_(eval("(1 + 2) * 3") == 9);
+  EXPECT_(eval("0x10 | 0b1 | 010") == 25);
+  EXPECT_(eval("-1 < 0 && !0 && ~0 == -1") == 1);
+  EXPECT_(eval("1 ? 2 : 3") == 2);
+  EXPECT_(eval("FOO_ENABLED and not FOO_LEVEL_HI") == 1);
+  EXPECT_(eval("VERSION >= 3") == 1);
+  EXPECT_(eval("__cplusplus >= 202002L") == 1);
+  EXPECT_(eval("defined(__clang__) && !defined __GNUC__") == 1);
+  EXPECT_(eval("__has_include(<vector>)") == 1);
+  EXPECT_(eval("true || false") == 1);
+}
+
+TEST_(unknowns) {
+  // Non-reserved identifiers might be defined by the target's compile definitions
+  EXPECT_(eval("BAR") == std::nullopt);
+  EXPECT_(eval("defined(BAR)") == std::nullopt);
+  // ... but they don't matter if the result doesn't depend on them
+  EXPECT_(eval("FOO_LEVEL_HI && BAR") == 0);
+  EXPECT_(eval("FOO_ENABLED || BAR(1, 2)") == 1);
+  EXPECT_(eval("BAR ? 1 : 1") == 1);
+
+  // Not all headers are visible when scanning
+  EXPECT_(eval("__has_include(\"missing.h\")") == std::nullopt);
+  // Function-like macros aren't expanded
+  EXPECT_(eval("__has_feature_stub(x)") == std::nullopt);
+  EXPECT_(eval("__has_builtin(__builtin_expect)") == std::nullopt);
+  EXPECT_(eval("1 / 0") == std::nullopt);
+  EXPECT_(eval("'a' == 97") == std::nullopt);
+  EXPECT_(eval("1 +") == std::nullopt);
+}
+
+TEST_(conditionals) {
+  Preprocessor preprocessor;
+  preprocessor.macros = predefined();
+  EXPECT_(preprocessor.directive("ifdef _WIN32\n"));
+  EXPECT_(preprocessor.state() == Preprocessor::SKIPPED);
+  EXPECT_(preprocessor.directive("if BAR // nested in a skipped group\n"));
+  EXPECT_(preprocessor.state() == Preprocessor::SKIPPED);
+  EXPECT_(preprocessor.directive("endif"));
+  EXPECT_(preprocessor.directive("elif FOO_ENABLED"));
+  EXPECT_(preprocessor.state() == Preprocessor::TAKEN);
+  EXPECT_(preprocessor.directive("else"));
+  EXPECT_(preprocessor.state() == Preprocessor::SKIPPED);
+  EXPECT_(preprocessor.directive("endif"));
+
+  EXPECT_(preprocessor.directive("if BAR"));
+  EXPECT_(preprocessor.state() == Preprocessor::UNDECIDED);
+  EXPECT_(preprocessor.directive("define BAZ 1"));
+  EXPECT_(preprocessor.directive("elif FOO_ENABLED"));
+  // Taken unless BAR was
+  EXPECT_(preprocessor.state() == Preprocessor::UNDECIDED);
+  EXPECT_(preprocessor.directive("else"));
+  EXPECT_(preprocessor.state() == Preprocessor::SKIPPED);
+  EXPECT_(preprocessor.directive("endif"));
+  // BAZ might or might not have been defined
+  EXPECT_(preprocessor.condition("ifdef", "BAZ") == std::nullopt);
+
+  EXPECT_(preprocessor.directive("define QUUX /* comment */ 2 \\\n + 1"));
+  EXPECT_(preprocessor.condition("if", "QUUX == 3") == true);
+  EXPECT_(preprocessor.condition("ifndef", "__GNUC__") == true);
+  EXPECT_(preprocessor.directive("include <version>"));
+  // <version> defines reserved macros
+  EXPECT_(preprocessor.condition("ifndef", "__GNUC__") == std::nullopt);
+  EXPECT_(preprocessor.condition("if", "__cpp_lib_modules") == std::nullopt);
+
+  EXPECT_(not preprocessor.directive("endif"));
+}
+
+TEST_(include_forgets_macros) {
+  Preprocessor preprocessor;
+  preprocessor.macros = predefined();
+  EXPECT_(preprocessor.directive("define LOCAL 1"));
+  EXPECT_(preprocessor.directive("undef GONE"));
+  EXPECT_(preprocessor.condition("ifdef", "LOCAL") == true);
+  EXPECT_(preprocessor.condition("ifdef", "GONE") == false);
+
+  EXPECT_(preprocessor.directive("include \"config.h\""));
+  // config.h might #undef or redefine anything defined so far
+  EXPECT_(preprocessor.condition("ifdef", "LOCAL") == std::nullopt);
+  EXPECT_(preprocessor.condition("ifdef", "GONE") == std::nullopt);
+  EXPECT_(preprocessor.condition("ifdef", "FOO_ENABLED") == std::nullopt);
+  EXPECT_(preprocessor.condition("if", "VERSION == 3") == std::nullopt);
+  EXPECT_(preprocessor.condition("ifdef", "__clang__") == std::nullopt);
+  // ... except the macros which the standard predefines
+  EXPECT_(preprocessor.condition("ifdef", "__cplusplus") == true);
+  EXPECT_(preprocessor.condition("if", "__STDC_HOSTED__") == true);
+}
+
+TEST_(system_include_keeps_command_line_macros) {
+  Preprocessor preprocessor;
+  preprocessor.macros = predefined();
+  preprocessor.macros.define("BAR_ENABLED", "1", true);
+  EXPECT_(preprocessor.directive("define LOCAL 1"));
+
+  EXPECT_(preprocessor.directive("include <vector>"));
+  // A system header won't redefine -D or option macros
+  EXPECT_(preprocessor.condition("ifdef", "BAR_ENABLED") == true);
+  EXPECT_(preprocessor.condition("ifdef", "LOCAL") == std::nullopt);
+  EXPECT_(preprocessor.condition("ifdef", "__clang__") == std::nullopt);
+
+  EXPECT_(preprocessor.directive("include \"config.h\""));
+  EXPECT_(preprocessor.condition("ifdef", "BAR_ENABLED") == std::nullopt);
+}
+
+TEST_(intersect_configurations) {
+  Macros debug, release;
+  debug.read_definitions("#define __clang__ 1\n#define FOO 1\n");
+  release.read_definitions(
+      "#define __clang__ 1\n#define FOO 0\n#define __OPTIMIZE__ 1\n");
+  debug.reserved_are_complete = release.reserved_are_complete = true;
+  debug.intersect(release);
+  EXPECT_(debug.lookup("__clang__").first == Macros::DEFINED);
+  EXPECT_(debug.lookup("FOO").first == Macros::UNKNOWN);
+  EXPECT_(debug.lookup("__OPTIMIZE__").first == Macros::UNKNOWN);
+  EXPECT_(debug.lookup("__GNUC__").first == Macros::UNDEFINED);
+}
@@ -1,3 +1,5 @@
+#include <chrono>
+#include <cstdlib>
 #include <filesystem>
 #include <sstream>
 #include <string>
@@ -6,57 +8,95 @@ import test_;
 import maud_;
 
 using std::operator""s;
+using std::chrono_literals::operator""min;
 
 auto const CASES = Parameter::read_file(DIR / "project.test.yaml");
 auto const TEST_DIR = std::filesystem::path{BUILD_DIR} / "_maud/project_tests";
+auto const TIMEOUT = 10min;
+
+SUITE_ {
+  SuiteState() {
+    // Shards of this suite run concurrently so each needs its own installation.
+    if (char const *shard = std::getenv("GTEST_SHARD_INDEX")) {
+      usr += "."s + shard;
+    }
+    std::filesystem::remove_all(usr);
+    std::filesystem::create_directories(usr);
+
+    auto install = spawn({"cmake", "--install", BUILD_DIR, "--prefix", usr.string(),
+                          "--config", "Debug"},
+                         TEST_DIR, Environment::current(), TIMEOUT);
+    installed = install.exit_code == 0;
+    install_output = std::move(install.output);
+  }
+
+  std::filesystem::path usr = TEST_DIR / "usr";
+  bool installed = false;
+  std::string install_output;
+};
 
 TEST_(project, CASES) {
+  // Every case needs maud installed, so every case fails without it.
+  bool installed = EXPECT_(suite_state()->installed) or [&](auto &os) {
+    os << "installing maud failed:\n" << suite_state()->install_output;
+  };
+  if (not installed) return;
+
+  // Each case gets a directory of its own so cases don't interfere when run
+  // concurrently. Commands run in src/, so ../usr is also specific to the case.
   auto name = parameter.name();
-  auto src = TEST_DIR / name;
-  auto usr = TEST_DIR / "usr";
+  auto dir = TEST_DIR / name;
+  auto src = dir / "src";
 
-  std::filesystem::remove_all(TEST_DIR);
+  std::filesystem::remove_all(dir);
   std::filesystem::create_directories(src);
-  std::filesystem::create_directories(usr);
-
-  auto install_cmd = "cmake --install \""s + BUILD_DIR + "\" --prefix \""s + usr.string()
-                   + "\" --config Debug";
-  if (not EXPECT_(std::system(install_cmd.c_str()) == 0)) return;
-
-  EnvironmentVariable _env[] = {
-      {"CXX",               //
-       [&](auto const &) { return CMAKE_CXX_COMPILER; }                   },
-      {PATH_VAR,
-       [&](auto const &path) { return (usr / "bin").string() + PATH_SEP + path; }      },
-      {"CMAKE_PREFIX_PATH",
-       [&](auto const &path) { return (usr / "lib/cmake").string() + PATH_SEP + path; }},
-  };
 
-  auto run = [](auto command, bool expect_success = true) {
-    return (expect_success ? EXPECT_(std::system(to_string(command).c_str()) == 0)
-                           : EXPECT_(std::system(to_string(command).c_str()) != 0))
-        or [&](auto &os) {
-      os << to_view(command);
+  auto const &usr = suite_state()->usr;
+  auto env = Environment::current();
+  env["CXX"] = CMAKE_CXX_COMPILER;
+  env[PATH_VAR] = (usr / "bin").string() + PATH_SEP + env[PATH_VAR];
+  env["CMAKE_PREFIX_PATH"] = (dir / "usr/lib/cmake").string() + PATH_SEP
+                           + (usr / "lib/cmake").string() + PATH_SEP
+                           + env["CMAKE_PREFIX_PATH"];
+
+  // A command's output must contain the expected output, if there is any.
+  auto run = [&](auto command,
+                 auto const &wd,
+                 bool expect_success = true,
+                 std::string_view expected_output = "") {
+    auto spawned = spawn(shell_command(to_string(command)), wd, env, TIMEOUT);
+    auto on_fail = [&](auto &os) {
+      os << to_view(command) << "\n" << spawned.output;
+      if (spawned.timed_out) os << "\n(timed out)";
     };
+    if (not((expect_success ? EXPECT_(spawned.exit_code == 0)
+                            : EXPECT_(spawned.exit_code != 0))
+            or on_fail)) {
+      return false;
+    }
+    return bool(EXPECT_(spawned.output >>= HasSubstr(std::string{expected_output})));
   };
 
   for (auto command : parameter) {
-    WorkingDirectory _wd{command.is_map() and command.has_child("working directory")
-                             ? src / to_string(command["working directory"])
-                             : src};
+    auto wd = command.is_map() and command.has_child("working directory")
+                ? src / to_string(command["working directory"])
+                : src;
 
     if (not command.is_map()) {
-      if (not run(command)) return;
+      if (not run(command, wd)) return;
       continue;
     }
 
+    std::string_view expected_output =
+        command.has_child("output") ? to_view(command["output"]) : "";
+
     if (command.has_child("command")) {
-      if (not run(command["command"])) return;
+      if (not run(command["command"], wd, true, expected_output)) return;
       continue;
     }
 
     if (command.has_child("failing command")) {
-      if (not run(command["failing command"], false)) return;
+      if (not run(command["failing command"], wd, false, expected_output)) return;
       continue;
     }
 
@@ -99,12 +139,12 @@ TEST_(project, CASES) {
     // FIXME this needs to be more generic to pass
     // on WIN where we have foo.lib instead of libfoo.a
     if (command.has_child("exists")) {
-      EXPECT_(std::filesystem::exists(to_string(command["exists"])));
+      EXPECT_(std::filesystem::exists(wd / to_string(command["exists"])));
       continue;
     }
 
     if (command.has_child("does not exist")) {
-      EXPECT_(not std::filesystem::exists(to_string(command["does not exist"])));
+      EXPECT_(not std::filesystem::exists(wd / to_string(command["does not exist"])));
       continue;
     }
   }
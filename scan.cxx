@@ -0,0 +1,310 @@
+// Boost Licensed
+//
+module;
+#include <memory_resource>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+export module maud_:scan;
+import :parsing;
+import :preprocessor;
+
+// TODO catch errors which are definitely a problem in the interface block:
+// - unterminated string
+// - malformed comment
+// - more than a single module decl
+// - `module` followed by not-a-module-name
+// - `import` followed by not-a-module-name
+// - `module` or `import` declaration not followed by attributes then semicolon
+// - anything other than a PP directive in the global module fragment
+// - malformed attributes
+
+// FIXME skip attributes
+
+// A module or partition name, as slices of the scanned source. A partition
+// import like `import :x;` is named with the module of the importing unit.
+export struct ModuleName {
+  std::string_view module, partition;
+
+  bool operator==(ModuleName const &) const = default;
+};
+
+export struct HeaderUnit {
+  std::string_view name;
+  // import <name>; rather than import "name";
+  bool angle;
+
+  bool operator==(HeaderUnit const &) const = default;
+};
+
+// The interface block of a source file. All names are slices of the scanned
+// source, and the imports are allocated from the arena passed to scan().
+export struct Scan {
+  // Empty for a source which isn't a module unit
+  ModuleName name;
+  bool is_interface = false;
+  std::pmr::vector<ModuleName> imports;
+  std::pmr::vector<HeaderUnit> header_units;
+  // Headers named by #include directives in groups which are certainly taken,
+  // for example in the global module fragment
+  std::pmr::vector<HeaderUnit> includes;
+
+  explicit Scan(std::pmr::memory_resource *arena)
+      : imports{arena}, header_units{arena}, includes{arena} {}
+
+  // Whether importers can name this unit (otherwise it is an implementation unit
+  // which requires its primary module interface, or not a module unit)
+  bool provides() const { return is_interface or not name.partition.empty(); }
+};
+
+// The header named by an #include directive (the text after '#'), unless the header
+// is named by a macro
+std::optional<HeaderUnit> include_directive(std::string_view directive) {
+  if (chomp_identifier(directive) != "include") return std::nullopt;
+  directive = trim(directive);
+  if (directive.empty() or (directive[0] != '<' and directive[0] != '"')) {
+    return std::nullopt;
+  }
+  bool angle = directive[0] == '<';
+  auto end = directive.find(angle ? '>' : '"', 1);
+  if (end == std::string_view::npos) return std::nullopt;
+  return HeaderUnit{directive.substr(1, end - 1), angle};
+}
+
+// Scan a NUL terminated source until the end of its imports. Returns nullopt if a
+// module or import declaration might be in a conditional group whose condition the
+// preprocessor couldn't decide, unless take_undecided (in which case such groups
+// are scanned as if they were taken).
+//
+// Nothing is allocated except from the arena (and by the preprocessor, for the
+// source's own #defines), so repeatedly scanning into a monotonic_buffer_resource
+// which is released between files doesn't touch the heap.
+export std::optional<Scan> scan(char const *s, Preprocessor &preprocessor,
+                                std::pmr::memory_resource *arena,
+                                bool take_undecided = false) {
+  auto undecided = [&] {
+    return not take_undecided and preprocessor.state() == Preprocessor::UNDECIDED;
+  };
+  Scan result{arena};
+  bool saw_export = false;
+
+  while (*s != 0) {
+    chomp_past_whitespace(s);
+    if (preprocessor.state() == Preprocessor::SKIPPED and s[0] != '#'
+        and not(s[0] == '/' and (s[1] == '/' or s[1] == '*'))) {
+      chomp_past_unescaped_line_ending(s);
+      continue;
+    }
+
+    switch (s[0]) {
+      case ';':
+        ++s;
+        continue;
+
+      case '#': {
+        auto directive = ++s;
+        chomp_past_unescaped_line_ending(s);
+        bool taken = preprocessor.state() == Preprocessor::TAKEN;
+        if (not preprocessor.directive({directive, s})) return std::nullopt;
+        if (auto header = include_directive({directive, s}); header and taken) {
+          result.includes.push_back(*header);
+        }
+        continue;
+      }
+
+      case '/':
+        if (s[1] == '/') {
+          chomp_past_unescaped_line_ending(s);
+          continue;
+        }
+
+        if (s[1] == '*') {
+          s += 2;
+          while (true) {
+            chomp_until(first_of<'*'>, s);
+            if (s[1] == '/') break;
+            ++s;
+          }
+          continue;
+        }
+
+        // nothing else could have started with '/'
+        goto done;
+
+      case 'm':
+        if (try_chomp_prefix("module", s)) {
+          if (undecided()) return std::nullopt;
+          chomp_past_whitespace(s);
+          if (*s == ';') {
+            // global module fragment; nothing to extract
+            ++s;
+            continue;
+          }
+
+          result.name.module = chomp_name(s);
+          result.is_interface = std::exchange(saw_export, false);
+
+          // is it a partition?
+          chomp_until(first_of<';', ':'>, s);
+          if (*s == ':') {
+            ++s;
+            chomp_past_whitespace(s);
+            result.name.partition = chomp_name(s);
+            chomp_until(first_of<';'>, s);
+          }
+          ++s;
+          continue;
+        }
+        [[fallthrough]];
+
+      case 'i':
+        if (try_chomp_prefix("import", s)) {
+          if (undecided()) return std::nullopt;
+          saw_export = false;
+          chomp_past_whitespace(s);
+          if (*s == ':') {
+            ++s;
+            chomp_past_whitespace(s);
+            result.imports.push_back({result.name.module, chomp_name(s)});
+          } else if (*s == '<' or *s == '"') {
+            // header unit; the header-name is not a string literal so no escapes
+            bool angle = *s++ == '<';
+            auto name_begin = s;
+            if (angle) {
+              chomp_until(first_of<'>', '\n'>, s);
+            } else {
+              chomp_until(first_of<'"', '\n'>, s);
+            }
+            result.header_units.push_back({{name_begin, s}, angle});
+            // A header unit's macros are visible after it is imported
+            preprocessor.macros.include(angle);
+          } else {
+            result.imports.push_back({chomp_name(s), {}});
+          }
+          chomp_until(first_of<';'>, s);
+          ++s;
+          continue;
+        }
+
+        // nothing else could have started with 'i'
+        goto done;
+
+      case 'e':
+        if (try_chomp_prefix("export", s)) {
+          if (undecided()) return std::nullopt;
+          saw_export = true;
+          continue;
+        }
+
+        // nothing else could have started with 'e'
+        goto done;
+
+      default:
+        goto done;
+    }
+  }
+
+done:
+  // The end of the interface block might only be the end of an undecided group
+  if (*s != 0 and undecided()) return std::nullopt;
+  return result;
+}
+
+void write_logical_name(std::ostream &out, ModuleName name) {
+  out << "\"" << name.module;
+  if (not name.partition.empty()) out << ":" << name.partition;
+  out << "\"";
+}
+
+// Write a scan in the JSON format described by p1689, as compilers do for
+// CMAKE_CXX_SCANDEP_SOURCE. With with_includes, the rule also lists the scan's
+// includes as spelled (like "<vector>") in the non-standard "_maud_includes".
+export void write_p1689(std::ostream &out, Scan const &scan, std::string_view source_path,
+                        std::string_view primary_output, bool with_header_units = true,
+                        bool with_includes = true) {
+  out << "{\n";
+  out << "  \"revision\": 0,\n";
+  out << "  \"rules\": [\n";
+  out << "    {\n";
+  out << "      \"primary-output\": ";
+  write_json_string(out, primary_output);
+
+  if (scan.provides()) {
+    out << ",\n";
+    out << "      \"provides\": [\n";
+    out << "        {\n";
+    out << "          \"is-interface\": " << (scan.is_interface ? "true" : "false");
+    out << ",\n";
+    out << "          \"logical-name\": ";
+    write_logical_name(out, scan.name);
+    out << ",\n";
+    out << "          \"source-path\": ";
+    write_json_string(out, source_path);
+    out << "\n";
+    out << "        }\n";
+    out << "      ]";
+  }
+
+  bool first = true;
+  auto next_require = [&] {
+    out << (first ? ",\n      \"requires\": [\n" : ",\n");
+    first = false;
+  };
+
+  // An implementation unit requires its primary module interface
+  if (not scan.provides() and not scan.name.module.empty()) {
+    next_require();
+    out << "        {\n";
+    out << "          \"logical-name\": ";
+    write_logical_name(out, {scan.name.module, {}});
+    out << "\n";
+    out << "        }";
+  }
+  for (auto const &name : scan.imports) {
+    next_require();
+    out << "        {\n";
+    out << "          \"logical-name\": ";
+    write_logical_name(out, name);
+    out << "\n";
+    out << "        }";
+  }
+  // Header units are named as spelled; the build system resolves them like includes.
+  for (auto const &[name, angle] : scan.header_units) {
+    if (not with_header_units) break;
+    next_require();
+    out << "        {\n";
+    out << "          \"logical-name\": ";
+    write_json_string(out, name);
+    out << ",\n";
+    auto lookup = angle ? "include-angle" : "include-quote";
+    out << "          \"lookup-method\": \"" << lookup << "\"\n";
+    out << "        }";
+  }
+  if (not first) {
+    out << "\n";
+    out << "      ]";
+  }
+
+  if (with_includes and not scan.includes.empty()) {
+    out << ",\n";
+    out << "      \"_maud_includes\": [";
+    bool first_include = true;
+    for (auto const &[name, angle] : scan.includes) {
+      out << (std::exchange(first_include, false) ? "\n" : ",\n") << "        ";
+      std::string spelled = angle ? "<" : "\"";
+      spelled.append(name).append(angle ? ">" : "\"");
+      write_json_string(out, spelled);
+    }
+    out << "\n";
+    out << "      ]";
+  }
+
+  out << "\n";
+  out << "    }\n";
+  out << "  ],\n";
+  out << "  \"version\": 1\n";
+  out << "}\n";
+}
@@ -1,5 +1,7 @@
 #include <filesystem>
 #include <iostream>
+#include <memory_resource>
+#include <sstream>
 #include <string>
 #include <string_view>
 import test_;
@@ -24,3 +26,129 @@ TEST_(scan) {
 
   std::cout << as_json(tree) << std::endl;
 }
+
+// Each case is `INPUT;EXPECTED` on one line, where EXPECTED is the prefix of INPUT
+// up to and including the end of its first string literal.
+TEST_(end_of_string_literal) {
+  auto cases = read(DIR / "end_of_string_literal.cases");
+  char const *c = cases.c_str();
+  while (*c != 0) {
+    if (c[0] == '#') {
+      chomp_until(first_of<'\n'>, c);
+      ++c;
+      continue;
+    }
+
+    auto *in_begin = c;
+    chomp_until(first_of<';'>, c);
+    std::string in{in_begin, c};
+    // Leave room for look ahead
+    in.resize(in.size() + 8);
+    ++c;
+
+    auto *expected_begin = c;
+    chomp_until(first_of<'\n'>, c);
+    std::string expected{expected_begin, c};
+    ++c;
+
+    auto *data = in.c_str();
+    chomp_until(first_of<'"'>, data);
+    chomp_until_end_of_string_literal(data);
+    EXPECT_(std::string{in.c_str(), data} == expected);
+  }
+}
+
+TEST_(scan_interface_block) {
+  std::string source = R"(
+    module;
+    #include <cassert>
+    export module foo:bar;
+    import :baz;
+    export import qux.quux;
+    import <vector>;
+    #if 0
+    import windows;
+    #endif
+    int x;
+    import not_in_the_interface_block;
+  )";
+  source.resize(source.size() + 8);
+
+  // Every allocation must come from the buffer
+  char buffer[1024];
+  std::pmr::monotonic_buffer_resource arena{buffer, sizeof(buffer),
+                                            std::pmr::null_memory_resource()};
+  Preprocessor preprocessor;
+  preprocessor.macros.reserved_are_complete = true;
+  auto scanned = scan(source.c_str(), preprocessor, &arena);
+  if (not EXPECT_(scanned.has_value())) return;
+  EXPECT_(scanned->is_interface);
+  EXPECT_(scanned->provides());
+  EXPECT_(scanned->name == ModuleName{"foo", "bar"});
+  if (not EXPECT_(scanned->imports.size() == 2)) return;
+  EXPECT_(scanned->imports[0] == ModuleName{"foo", "baz"});
+  EXPECT_(scanned->imports[1] == ModuleName{"qux.quux", ""});
+  if (not EXPECT_(scanned->header_units.size() == 1)) return;
+  EXPECT_(scanned->header_units[0] == HeaderUnit{"vector", true});
+  if (not EXPECT_(scanned->includes.size() == 1)) return;
+  EXPECT_(scanned->includes[0] == HeaderUnit{"cassert", true});
+
+  // Names are slices of the source
+  auto *begin = source.data(), *end = begin + source.size();
+  EXPECT_(scanned->name.partition.data() >= begin);
+  EXPECT_(scanned->name.partition.data() < end);
+
+  std::ostringstream p1689;
+  write_p1689(p1689, *scanned, "foo.cxx", "foo.cxx.o");
+  EXPECT_(p1689.str().find(R"("logical-name": "foo:baz")") != std::string::npos);
+  EXPECT_(p1689.str().find(R"("_maud_includes": [
+        "<cassert>")") != std::string::npos);
+}
+
+TEST_(scan_includes) {
+  std::string source = R"(
+    #include "foo.hxx"
+    # include <fmt/format.h> // trailing comment
+    #include_next <bar.hxx>
+    #include HEADER_MACRO
+    #if UNDECIDED
+    #include <maybe.hxx>
+    #elif 0
+    #include <never.hxx>
+    #endif
+    import executable;
+    #include <after_imports.hxx>
+    int main() {}
+    #include <not_in_the_interface_block.hxx>
+  )";
+  source.resize(source.size() + 8);
+
+  std::pmr::monotonic_buffer_resource arena;
+  Preprocessor preprocessor;
+  auto scanned = scan(source.c_str(), preprocessor, &arena);
+  if (not EXPECT_(scanned.has_value())) return;
+  EXPECT_(not scanned->provides());
+  if (not EXPECT_(scanned->includes.size() == 3)) return;
+  EXPECT_(scanned->includes[0] == HeaderUnit{"foo.hxx", false});
+  EXPECT_(scanned->includes[1] == HeaderUnit{"fmt/format.h", true});
+  EXPECT_(scanned->includes[2] == HeaderUnit{"after_imports.hxx", true});
+
+  std::ostringstream p1689;
+  write_p1689(p1689, *scanned, "main.cxx", "main.cxx.o", true, false);
+  EXPECT_(p1689.str().find("_maud_includes") == std::string::npos);
+}
+
+TEST_(scan_undecided) {
+  std::string source = "module foo;\n#if BAR\nimport bar;\n#endif\n";
+  source.resize(source.size() + 8);
+  std::pmr::monotonic_buffer_resource arena;
+  Preprocessor preprocessor;
+  EXPECT_(not scan(source.c_str(), preprocessor, &arena));
+
+  Preprocessor take;
+  auto scanned = scan(source.c_str(), take, &arena, true);
+  if (not EXPECT_(scanned.has_value())) return;
+  EXPECT_(not scanned->provides());
+  EXPECT_(scanned->name == ModuleName{"foo", ""});
+  EXPECT_(scanned->imports.size() == 1);
+}
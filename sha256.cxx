@@ -0,0 +1,97 @@
+// Boost Licensed
+//
+module;
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+export module maud_:sha256;
+
+// SHA-256 (FIPS 180-4), used to address cached compilation results by content.
+export class Sha256 {
+ public:
+  Sha256 &update(std::string_view data) {
+    _length += data.size();
+    for (unsigned char c : data) {
+      _block[_block_size++] = c;
+      if (_block_size == _block.size()) compress();
+    }
+    return *this;
+  }
+
+  std::string hex_digest() const {
+    Sha256 padded = *this;
+    uint64_t bits = _length * 8;
+    padded._block[padded._block_size++] = 0x80;
+    if (padded._block_size > 56) {
+      while (padded._block_size < 64) padded._block[padded._block_size++] = 0;
+      padded.compress();
+    }
+    while (padded._block_size < 56) padded._block[padded._block_size++] = 0;
+    for (int i = 7; i >= 0; --i) padded._block[padded._block_size++] = bits >> (i * 8);
+    padded.compress();
+
+    constexpr std::string_view HEX = "0123456789abcdef";
+    std::string digest;
+    for (uint32_t word : padded._state) {
+      for (int i = 7; i >= 0; --i) digest += HEX[(word >> (i * 4)) & 0xf];
+    }
+    return digest;
+  }
+
+ private:
+  void compress() {
+    constexpr std::array<uint32_t, 64> K{
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+        0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+        0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+        0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+        0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+        0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+        0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+        0xc67178f2,
+    };
+    using std::rotr;
+
+    std::array<uint32_t, 64> w;
+    for (size_t i = 0; i < 16; ++i) {
+      w[i] = uint32_t{_block[i * 4]} << 24 | uint32_t{_block[i * 4 + 1]} << 16
+           | uint32_t{_block[i * 4 + 2]} << 8 | uint32_t{_block[i * 4 + 3]};
+    }
+    for (size_t i = 16; i < 64; ++i) {
+      uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    auto [a, b, c, d, e, f, g, h] = _state;
+    for (size_t i = 0; i < 64; ++i) {
+      uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+      uint32_t t1 = h + s1 + ((e & f) ^ (~e & g)) + K[i] + w[i];
+      uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+      uint32_t t2 = s0 + ((a & b) ^ (a & c) ^ (b & c));
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+    _state = {_state[0] + a, _state[1] + b, _state[2] + c, _state[3] + d,
+              _state[4] + e, _state[5] + f, _state[6] + g, _state[7] + h};
+    _block_size = 0;
+  }
+
+  std::array<uint32_t, 8> _state{
+      0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+      0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+  };
+  std::array<unsigned char, 64> _block;
+  size_t _block_size = 0;
+  uint64_t _length = 0;
+};
@@ -0,0 +1,27 @@
+#include <string>
+import test_;
+import maud_;
+
+TEST_(known_digests) {
+  EXPECT_(Sha256{}.hex_digest()
+          == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  EXPECT_(Sha256{}.update("abc").hex_digest()
+          == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  EXPECT_(Sha256{}
+              .update("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")
+              .hex_digest()
+          == "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+  EXPECT_(Sha256{}.update(std::string(1'000'000, 'a')).hex_digest()
+          == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST_(incremental_update) {
+  Sha256 whole, pieces;
+  whole.update("The quick brown fox jumps over the lazy dog");
+  pieces.update("The quick brown ").update("fox jumps over ").update("the lazy dog");
+  EXPECT_(whole.hex_digest() == pieces.hex_digest());
+  // Digesting doesn't finish the hash
+  pieces.update(".");
+  EXPECT_(pieces.hex_digest()
+          == "ef537f25c895bfa782526529a9b63d97aa631564d5d789c2b765448c8635fb6c");
+}
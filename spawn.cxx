@@ -0,0 +1,296 @@
+module;
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <crt_externs.h>
+#define environ (*_NSGetEnviron())
+#endif
+#endif
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+export module maud_:spawn;
+
+using std::chrono_literals::operator""ms;
+
+// An explicit process environment. Unlike EnvironmentVariable, modifying
+// this never touches the environment of the current process.
+export struct Environment : std::map<std::string, std::string> {
+  static Environment current() {
+    Environment env;
+#ifdef _WIN32
+    char *block = GetEnvironmentStringsA();
+    for (char *var = block; *var != '\0'; var += std::strlen(var) + 1) {
+      // skip the per-drive working directory entries like "=C:=C:\foo"
+      if (auto eq = std::strchr(var + 1, '=')) env.emplace(std::string(var, eq), eq + 1);
+    }
+    FreeEnvironmentStringsA(block);
+#else
+    for (char **var = environ; *var != nullptr; ++var) {
+      if (auto eq = std::strchr(*var, '=')) env.emplace(std::string(*var, eq), eq + 1);
+    }
+#endif
+    return env;
+  }
+};
+
+export struct Spawned {
+  int exit_code = -1;
+  bool timed_out = false;
+  // stdout and stderr of the process, interleaved
+  std::string output;
+};
+
+// Wrap a command line so that it will be interpreted by the platform's shell.
+export std::vector<std::string> shell_command(std::string command) {
+#ifdef _WIN32
+  return {"cmd.exe", "/c", std::move(command)};
+#else
+  return {"/bin/sh", "-c", std::move(command)};
+#endif
+}
+
+// Run a command to completion in the given working directory and environment,
+// capturing its output. If it has not completed before the timeout it is killed.
+//
+// Nothing about the current process (environment, working directory,
+// standard streams) is modified, so spawn may be called concurrently.
+export Spawned spawn(std::vector<std::string> const &command,
+                     std::filesystem::path const &working_directory,
+                     Environment const &environment, std::chrono::milliseconds timeout);
+
+// Run a command to completion in the given working directory, returning its exit
+// code. It inherits this process's environment and standard streams, so its output
+// is shown as it is written rather than captured.
+export int run_attached(std::vector<std::string> const &command,
+                        std::filesystem::path const &working_directory);
+
+#ifdef _WIN32
+std::string quote_argument(std::string const &arg) {
+  if (not arg.empty() and arg.find_first_of(" \t\"") == std::string::npos) return arg;
+
+  std::string quoted = "\"";
+  size_t backslashes = 0;
+  for (char c : arg) {
+    if (c == '\\') {
+      ++backslashes;
+      continue;
+    }
+    // backslashes are only special when they precede a quote
+    quoted.append(c == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+    quoted += c;
+    backslashes = 0;
+  }
+  quoted.append(backslashes * 2, '\\');
+  return quoted += '"';
+}
+
+Spawned spawn(std::vector<std::string> const &command,
+              std::filesystem::path const &working_directory,
+              Environment const &environment, std::chrono::milliseconds timeout) {
+  std::string command_line;
+  for (auto const &arg : command) {
+    if (not command_line.empty()) command_line += ' ';
+    command_line += quote_argument(arg);
+  }
+
+  std::string environment_block;
+  for (auto const &[name, value] : environment) {
+    environment_block += name + "=" + value;
+    environment_block += '\0';
+  }
+  environment_block += '\0';
+
+  SECURITY_ATTRIBUTES inheritable{sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+  HANDLE read_pipe, write_pipe;
+  if (not CreatePipe(&read_pipe, &write_pipe, &inheritable, 0)) {
+    return {.output = "CreatePipe failed"};
+  }
+  SetHandleInformation(read_pipe, HANDLE_FLAG_INHERIT, 0);
+
+  STARTUPINFOA startup{};
+  startup.cb = sizeof(startup);
+  startup.dwFlags = STARTF_USESTDHANDLES;
+  startup.hStdOutput = startup.hStdError = write_pipe;
+
+  PROCESS_INFORMATION process;
+  auto wd = working_directory.string();
+  if (not CreateProcessA(nullptr, command_line.data(), nullptr, nullptr, TRUE, 0,
+                         environment_block.data(), wd.c_str(), &startup, &process)) {
+    CloseHandle(read_pipe);
+    CloseHandle(write_pipe);
+    return {.output = "CreateProcess failed for " + command_line};
+  }
+  CloseHandle(write_pipe);
+  CloseHandle(process.hThread);
+
+  Spawned spawned;
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  char buffer[4096];
+  auto drain = [&] {
+    DWORD available = 0, n = 0;
+    while (PeekNamedPipe(read_pipe, nullptr, 0, nullptr, &available, nullptr)
+           and available != 0
+           and ReadFile(read_pipe, buffer, sizeof(buffer), &n, nullptr) and n != 0) {
+      spawned.output.append(buffer, n);
+    }
+  };
+  while (WaitForSingleObject(process.hProcess, 50) == WAIT_TIMEOUT) {
+    drain();
+    if (std::chrono::steady_clock::now() > deadline) {
+      TerminateProcess(process.hProcess, 1);
+      WaitForSingleObject(process.hProcess, INFINITE);
+      spawned.timed_out = true;
+      break;
+    }
+  }
+  drain();
+
+  DWORD exit_code;
+  GetExitCodeProcess(process.hProcess, &exit_code);
+  spawned.exit_code = static_cast<int>(exit_code);
+  CloseHandle(process.hProcess);
+  CloseHandle(read_pipe);
+  return spawned;
+}
+
+int run_attached(std::vector<std::string> const &command,
+                 std::filesystem::path const &working_directory) {
+  std::string command_line;
+  for (auto const &arg : command) {
+    if (not command_line.empty()) command_line += ' ';
+    command_line += quote_argument(arg);
+  }
+
+  STARTUPINFOA startup{};
+  startup.cb = sizeof(startup);
+  startup.dwFlags = STARTF_USESTDHANDLES;
+  startup.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+  startup.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+  startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+  PROCESS_INFORMATION process;
+  auto wd = working_directory.string();
+  if (not CreateProcessA(nullptr, command_line.data(), nullptr, nullptr, TRUE, 0, nullptr,
+                         wd.c_str(), &startup, &process)) {
+    return -1;
+  }
+  CloseHandle(process.hThread);
+  WaitForSingleObject(process.hProcess, INFINITE);
+  DWORD exit_code;
+  GetExitCodeProcess(process.hProcess, &exit_code);
+  CloseHandle(process.hProcess);
+  return static_cast<int>(exit_code);
+}
+#else
+Spawned spawn(std::vector<std::string> const &command,
+              std::filesystem::path const &working_directory,
+              Environment const &environment, std::chrono::milliseconds timeout) {
+  // Everything the child needs is prepared before fork() so that
+  // the child does nothing but redirect and exec.
+  std::vector<char *> argv;
+  for (auto const &arg : command) argv.push_back(const_cast<char *>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  std::vector<std::string> variables;
+  for (auto const &[name, value] : environment) variables.push_back(name + "=" + value);
+  std::vector<char *> envp;
+  for (auto &var : variables) envp.push_back(var.data());
+  envp.push_back(nullptr);
+
+  int pipe_fds[2];
+  if (pipe(pipe_fds) != 0) return {.output = "pipe() failed"};
+  int dev_null = open("/dev/null", O_RDONLY);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    setpgid(0, 0);
+    dup2(dev_null, STDIN_FILENO);
+    dup2(pipe_fds[1], STDOUT_FILENO);
+    dup2(pipe_fds[1], STDERR_FILENO);
+    close(dev_null);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    if (chdir(working_directory.c_str()) != 0) _exit(127);
+    // execvp searches the PATH of environ, so that must be the new environment
+    environ = envp.data();
+    execvp(argv[0], argv.data());
+    _exit(127);
+  }
+
+  close(dev_null);
+  close(pipe_fds[1]);
+  if (pid < 0) {
+    close(pipe_fds[0]);
+    return {.output = "fork() failed"};
+  }
+  setpgid(pid, pid);
+
+  Spawned spawned;
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  pollfd output{.fd = pipe_fds[0], .events = POLLIN};
+  char buffer[4096];
+  int status = 0;
+  bool eof = false;
+  while (waitpid(pid, &status, WNOHANG) != pid) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      kill(-pid, SIGKILL);
+      waitpid(pid, &status, 0);
+      spawned.timed_out = true;
+      break;
+    }
+    if (eof) {
+      std::this_thread::sleep_for(10ms);
+      continue;
+    }
+    if (poll(&output, 1, 50) <= 0) continue;
+    auto n = read(output.fd, buffer, sizeof(buffer));
+    if (n > 0) spawned.output.append(buffer, n);
+    if (n == 0) eof = true;
+  }
+
+  // A daemon started by the child may have inherited the pipe, so
+  // don't wait for EOF; just read whatever is already buffered.
+  fcntl(output.fd, F_SETFL, O_NONBLOCK);
+  for (ssize_t n; (n = read(output.fd, buffer, sizeof(buffer))) > 0;) {
+    spawned.output.append(buffer, n);
+  }
+  close(output.fd);
+
+  spawned.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+  return spawned;
+}
+
+int run_attached(std::vector<std::string> const &command,
+                 std::filesystem::path const &working_directory) {
+  std::vector<char *> argv;
+  for (auto const &arg : command) argv.push_back(const_cast<char *>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    if (chdir(working_directory.c_str()) != 0) _exit(127);
+    execvp(argv[0], argv.data());
+    _exit(127);
+  }
+  if (pid < 0) return -1;
+
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) return -1;
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+#endif
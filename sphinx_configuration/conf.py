@@ -71,11 +71,12 @@ extlinks = {
     "cxx20": ("https://timsong-cpp.github.io/cppwp/n4868/%s", "CXX(20:%s)"),
     # TODO this should be intersphinx instead
     "cmake": ("https://cmake.org/cmake/help/latest/%s", None),
+    "clang": ("https://clang.llvm.org/docs/%s", None),
     "gtest": ("https://google.github.io/googletest/%s", None),
     "sphinx": ("https://www.sphinx-doc.org/en/master/usage/%s", None)
 }
 
-# TODO get trike files from cmake
+# Only used if MAUD_APIDOC_PATTERNS is not set (see apidoc.cmake)
 trike_files = [
     *maud.cache.CMAKE_SOURCE_DIR.glob("*.cxx"),
     *maud.cache.CMAKE_SOURCE_DIR.glob("cmake_modules/*.cxx"),
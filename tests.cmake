@@ -3,9 +3,44 @@ add_compile_definitions(
   "CMAKE_CXX_COMPILER=\"${CMAKE_CXX_COMPILER}\""
 )
 
-add_test(
-  NAME pytest.trike
-  COMMAND
-    "${CMAKE_BUILD_DIR}/documentation/venv/bin/pytest" -vv
-    "${CMAKE_SOURCE_DIR}/cmake_modules/trike"
-)
+# Sphinx's python is only known once documentation is set up, after this file is included
+function(add_trike_test)
+  if(NOT _MAUD_SPHINX_PYTHON)
+    return()
+  endif()
+  add_test(
+    NAME pytest.trike
+    COMMAND
+      ${_MAUD_SPHINX_PYTHON} -m pytest -vv
+      "${CMAKE_SOURCE_DIR}/cmake_modules/trike"
+  )
+endfunction()
+cmake_language(DEFER CALL add_trike_test)
+
+# Project test cases don't share any state besides a read-only installation of
+# Maud, so split them into shards which ctest can run concurrently.
+set(PROJECT_TEST_SHARDS 4)
+function(shard_project_tests)
+  if(NOT TEST test_.project)
+    return()
+  endif()
+  set_tests_properties(
+    test_.project
+    PROPERTIES
+    ENVIRONMENT "GTEST_TOTAL_SHARDS=${PROJECT_TEST_SHARDS};GTEST_SHARD_INDEX=0"
+  )
+  math(EXPR last_shard "${PROJECT_TEST_SHARDS} - 1")
+  foreach(shard RANGE 1 ${last_shard})
+    add_test(
+      NAME test_.project.${shard}
+      COMMAND $<TARGET_FILE:test_.project> --gtest_brief=1
+    )
+    set_tests_properties(
+      test_.project.${shard}
+      PROPERTIES
+      ENVIRONMENT "GTEST_TOTAL_SHARDS=${PROJECT_TEST_SHARDS};GTEST_SHARD_INDEX=${shard}"
+    )
+  endforeach()
+endfunction()
+# test_.project is only defined once sources are scanned, after this file is included
+cmake_language(DEFER CALL shard_project_tests)
@@ -0,0 +1,158 @@
+// Boost Licensed
+//
+module;
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+export module maud_:watch;
+
+namespace fs = std::filesystem;
+
+using std::chrono_literals::operator""ms;
+
+// Hidden files and directories (including .build and .git) are never watched,
+// just as they are excluded from Maud's globs. Neither is the build directory,
+// wherever it is.
+bool is_ignored(fs::path const &path, fs::path const &build_dir) {
+  return path.filename().string().starts_with(".") or path == build_dir;
+}
+
+template <typename F>
+void for_each_entry(fs::path const &dir, fs::path const &build_dir, F f) {
+  std::error_code ec;
+  for (auto it = fs::recursive_directory_iterator{dir, ec};
+       it != fs::recursive_directory_iterator{}; it.increment(ec)) {
+    if (ec) break;
+    if (is_ignored(it->path(), build_dir)) {
+      if (it->is_directory(ec)) it.disable_recursion_pending();
+      continue;
+    }
+    f(*it);
+  }
+}
+
+#ifdef __linux__
+// Watch directories (and any directories created in them) with inotify.
+export struct Watcher {
+  fs::path build_dir;
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  std::map<int, fs::path> directories;
+
+  Watcher(std::vector<fs::path> const &dirs, fs::path build_dir)
+      : build_dir{fs::absolute(build_dir).lexically_normal()} {
+    for (auto const &dir : dirs) add(fs::absolute(dir).lexically_normal());
+  }
+  Watcher(Watcher const &) = delete;
+  ~Watcher() { close(fd); }
+
+  void add(fs::path const &dir) {
+    constexpr auto MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM
+                        | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR;
+    int wd = inotify_add_watch(fd, dir.c_str(), MASK);
+    if (wd < 0) return;
+    directories[wd] = dir;
+    for_each_entry(dir, build_dir, [&](fs::directory_entry const &entry) {
+      std::error_code ec;
+      if (not entry.is_directory(ec)) return;
+      int wd = inotify_add_watch(fd, entry.path().c_str(), MASK);
+      if (wd >= 0) directories[wd] = entry.path();
+    });
+  }
+
+  // Wait up to the timeout for a change, returning whether one happened.
+  bool wait(std::chrono::milliseconds timeout) {
+    pollfd events{.fd = fd, .events = POLLIN, .revents = 0};
+    if (poll(&events, 1, static_cast<int>(timeout.count())) <= 0) return false;
+
+    alignas(inotify_event) char buffer[64 * 1024];
+    bool changed = false;
+    for (ssize_t n; (n = read(fd, buffer, sizeof(buffer))) > 0;) {
+      for (char *p = buffer; p < buffer + n;) {
+        auto *event = reinterpret_cast<inotify_event *>(p);
+        p += sizeof(inotify_event) + event->len;
+
+        if (event->mask & IN_IGNORED) {
+          directories.erase(event->wd);
+          continue;
+        }
+        auto dir = directories.find(event->wd);
+        if (dir == directories.end()) continue;
+
+        fs::path path = dir->second;
+        if (event->len != 0) path /= event->name;
+        if (is_ignored(path, build_dir)) continue;
+        if ((event->mask & IN_ISDIR) and (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+          add(path);
+        }
+        changed = true;
+      }
+    }
+    return changed;
+  }
+};
+#else
+// Without inotify, poll the watched directories for changed mtimes.
+export struct Watcher {
+  fs::path build_dir;
+  std::vector<fs::path> dirs;
+  std::map<fs::path, fs::file_time_type> snapshot;
+
+  Watcher(std::vector<fs::path> const &dirs, fs::path build_dir)
+      : build_dir{fs::absolute(build_dir).lexically_normal()} {
+    for (auto const &dir : dirs) {
+      this->dirs.push_back(fs::absolute(dir).lexically_normal());
+    }
+    snapshot = take_snapshot();
+  }
+
+  std::map<fs::path, fs::file_time_type> take_snapshot() const {
+    std::map<fs::path, fs::file_time_type> files;
+    for (auto const &dir : dirs) {
+      for_each_entry(dir, build_dir, [&](fs::directory_entry const &entry) {
+        std::error_code ec;
+        files[entry.path()] = entry.last_write_time(ec);
+      });
+    }
+    return files;
+  }
+
+  bool wait(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    do {
+      auto files = take_snapshot();
+      if (files != snapshot) {
+        snapshot = std::move(files);
+        return true;
+      }
+      std::this_thread::sleep_for(std::min(timeout, 250ms));
+    } while (std::chrono::steady_clock::now() < deadline);
+    return false;
+  }
+};
+#endif
+
+// test_ executables, with their mtimes
+export std::map<fs::path, fs::file_time_type> test_executables(fs::path const &build) {
+  std::map<fs::path, fs::file_time_type> tests;
+  std::error_code ec;
+  for (auto const &entry : fs::recursive_directory_iterator{build, ec}) {
+    auto name = entry.path().filename().string();
+    if (not name.starts_with("test_.") or not entry.is_regular_file(ec)) continue;
+#ifdef _WIN32
+    if (not name.ends_with(".exe")) continue;
+#else
+    auto permissions = entry.status(ec).permissions();
+    if ((permissions & fs::perms::owner_exec) == fs::perms::none) continue;
+#endif
+    tests[entry.path()] = entry.last_write_time(ec);
+  }
+  return tests;
+}
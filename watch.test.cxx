@@ -0,0 +1,66 @@
+#include <chrono>
+#include <filesystem>
+import test_;
+import maud_;
+
+namespace fs = std::filesystem;
+
+using std::chrono_literals::operator""ms;
+
+auto const TEST_DIR = fs::path{BUILD_DIR} / "_maud/watch_tests";
+
+fs::path fresh_dir(std::string_view name) {
+  auto dir = TEST_DIR / name;
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  return dir;
+}
+
+TEST_(changes_are_seen) {
+  auto dir = fresh_dir("changes");
+  fs::create_directories(dir / "sub");
+  Watcher watcher{{dir}, dir / ".build"};
+  EXPECT_(not watcher.wait(50ms));
+
+  write(dir / "sub/foo.cxx") << "int foo;";
+  EXPECT_(watcher.wait(2000ms));
+  while (watcher.wait(300ms)) {
+  }
+
+  // Directories created while watching are watched too
+  fs::create_directories(dir / "new");
+  EXPECT_(watcher.wait(2000ms));
+  while (watcher.wait(300ms)) {
+  }
+  write(dir / "new/bar.cxx") << "int bar;";
+  EXPECT_(watcher.wait(2000ms));
+}
+
+TEST_(ignored_changes) {
+  auto dir = fresh_dir("ignored");
+  fs::create_directories(dir / "build");
+  fs::create_directories(dir / ".git");
+  Watcher watcher{{dir}, dir / "build"};
+
+  write(dir / ".hidden.cxx") << "int hidden;";
+  write(dir / ".git/HEAD") << "ref: refs/heads/main";
+  write(dir / "build/foo.o") << "";
+  EXPECT_(not watcher.wait(300ms));
+}
+
+TEST_(relinked_tests_are_found) {
+  auto dir = fresh_dir("tests");
+#ifdef _WIN32
+  auto test = dir / "Debug/test_.foo.exe";
+#else
+  auto test = dir / "Debug/test_.foo";
+#endif
+  write(test) << "";
+  write(dir / "Debug/foo") << "";
+  write(dir / "test_.foo.cxx.o") << "";
+  fs::permissions(test, fs::perms::owner_exec, fs::perm_options::add);
+
+  auto tests = test_executables(dir);
+  if (not EXPECT_(tests.size() == 1)) return;
+  EXPECT_(tests.begin()->first == test);
+}